@@ -1,13 +1,31 @@
 #ifndef CSE_H
 #define CSE_H
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <optional>
+#include <ostream>
 #include <utility>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
+#include <string_view>
 #include <stdexcept>
 
 #include "Tree.h"
+#include "RpalString.h"
+#include "Integer.h"
+#include "Output.h"
+#include "TaskPool.h"
 
 // Types of nodes are enumerated for CSE machine
 enum class TypeOfObject : int
@@ -20,42 +38,283 @@ enum class TypeOfObject : int
     OPERATOR,
     BETA,
     EETA,
+    REC_LAMBDA,
     DELTA,
     TAU,
     ENVIRONMENT,
     LIST,
-    BOOLEAN
+    BOOLEAN,
+    BIND,    // binds the value on top of the stack in the current environment, for a lambda compiled into its frame
+    UNBIND,  // ends the scope of a BIND
+    PARALLEL, // evaluates the components of a tuple or an operator, each compiled into a control structure, on threads
+    SPECULATE, // starts the branches of a conditional on threads, then evaluates its condition
+    GAMMA_N,   // applies a function to as many arguments as its cs index, in one frame when it is curried that deep
+
+    // superinstructions fused from the nodes of a control structure before evaluation, the leaves they take their
+    // operands from are kept as their elements
+    CALL,      // applies the function named by an identifier, to a leaf or to the value on the stack
+    BUILTIN,   // applies the built-in function named by its value, to a leaf or to the value on the stack
+    OPERATION, // applies the operator named by its value to leaves
+    BRANCH     // delta delta beta with the condition, applying the operator named by its value first if there is one
 };
 
 std::vector<std::string> builtInFunctions = {"Print", "print", "Order", "Y*", "Conc", "Stem", "Stern", "Isinteger", "Isstring",
                                              "Istuple", "Isempty", "dummy", "ItoS"};
 
 bool is_operator(const std::string &labelOfNode);
+bool is_recursive_binding(const StandardizedNode &root);
+
+// Read-only view of a sequence of values kept elsewhere, such as the elements of a tuple
+template <typename T>
+class Span
+{
+private:
+    const T *first = nullptr;
+    std::size_t count = 0;
+
+public:
+    Span() = default;
+
+    Span(const T *first, std::size_t count) : first(first), count(count) {}
+
+    const T *begin() const
+    {
+        return first;
+    }
+
+    const T *end() const
+    {
+        return first + count;
+    }
+
+    std::size_t size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    const T &operator[](std::size_t index) const
+    {
+        return first[index];
+    }
+};
+
+/**
+ * Name of a variable interned in the table of all names, so the environments compare names by their address.
+ * Names are interned while the control structures are created, the table only grows.
+ */
+class Symbol
+{
+private:
+    const std::string *name = nullptr;
+
+    explicit Symbol(const std::string *name) : name(name) {}
+
+public:
+    Symbol() = default;
+
+    static Symbol intern(const std::string &name)
+    {
+        static std::mutex lock;
+        static std::unordered_set<std::string> names;
+
+        std::lock_guard<std::mutex> guard(lock);
+        return Symbol(&*names.insert(name).first);
+    }
+
+    const std::string &get_name() const
+    {
+        static const std::string noName;
+        return name != nullptr ? *name : noName;
+    }
+
+    bool operator==(const Symbol &other) const
+    {
+        return name == other.name;
+    }
+
+    bool operator!=(const Symbol &other) const
+    {
+        return name != other.name;
+    }
+
+    std::size_t hash() const
+    {
+        return std::hash<const std::string *>()(name);
+    }
+};
+
+class Environment;
+
+/**
+ * Counted reference to a heap environment. An environment is released when the last reference to it goes, so the
+ * closures and control markers that refer to it keep it alive. The closure a rec environment binds to itself holds
+ * an uncounted reference, otherwise the environment would keep itself alive; copies of it are counted again.
+ */
+class EnvironmentRef
+{
+private:
+    Environment *environment = nullptr;
+    bool counted = true;
+
+    static void acquire(Environment *environment);
+    static void release(Environment *environment);
+
+public:
+    EnvironmentRef() = default;
+
+    // takes a new reference to the environment
+    explicit EnvironmentRef(Environment *environment) : environment(environment)
+    {
+        acquire(environment);
+    }
+
+    EnvironmentRef(const EnvironmentRef &other) : environment(other.environment)
+    {
+        acquire(environment);
+    }
+
+    EnvironmentRef(EnvironmentRef &&other) noexcept : environment(other.environment), counted(other.counted)
+    {
+        other.environment = nullptr;
+        other.counted = true;
+    }
+
+    EnvironmentRef &operator=(const EnvironmentRef &other)
+    {
+        EnvironmentRef copy(other);
+        return *this = std::move(copy);
+    }
+
+    EnvironmentRef &operator=(EnvironmentRef &&other) noexcept
+    {
+        std::swap(environment, other.environment);
+        std::swap(counted, other.counted);
+        return *this;
+    }
+
+    ~EnvironmentRef()
+    {
+        if (counted)
+        {
+            release(environment);
+        }
+    }
+
+    // reference to the same environment that does not keep it alive
+    EnvironmentRef uncounted() const
+    {
+        EnvironmentRef reference;
+        reference.environment = environment;
+        reference.counted = false;
+        return reference;
+    }
+
+    Environment *get() const
+    {
+        return environment;
+    }
+
+    Environment *operator->() const
+    {
+        return environment;
+    }
+
+    bool operator==(const EnvironmentRef &other) const
+    {
+        return environment == other.environment;
+    }
+};
 
 class CseNode
 {
 private:
+    /**
+     * Elements of a tuple, shared by the copies of the tuple and by the tuples aug made from it. A tuple sees the
+     * first listSize of them, the places after those are taken by the longer tuples in the order aug makes them.
+     * The elements never move, so a tuple can be read while another one is made from it.
+     */
+    struct TupleElements
+    {
+        std::unique_ptr<CseNode[]> elements;
+        int capacity;
+        std::atomic<int> used; // places taken by the tuples sharing the elements
+
+        explicit TupleElements(int capacity) : elements(new CseNode[capacity]), capacity(capacity), used(0) {}
+    };
+
     // General node properties
     TypeOfObject typeOfNode;
+    int listSize{}; // number of elements of list nodes
     std::string valueOfNode;
+    Symbol symbol; // the name of identifier, bind and unbind nodes and the bound variable of lambda nodes
 
     // CseNode properties for lambda and eeta nodes
-    int environment{};
+    EnvironmentRef environment;
     int csIndex{}; // for delta, tau, eeta, lambda nodes
-    std::vector<std::string> boundVariables;
-    std::vector<CseNode> listOfElements;
+    int site = -1; // quickening site of operator and gamma instructions, -1 for other nodes
+    std::shared_ptr<const std::vector<Symbol>> boundVariables; // shared by the closures of the lambda
+
+    // CseNode property for list nodes, tuples are never changed so the copies of a tuple share its elements
+    std::shared_ptr<TupleElements> listOfElements;
     bool isOneBoundVariable = true;
+    bool proven = false; // type inference proved the operands of the operator or gamma instruction
+
+    // CseNode property for rec lambda nodes, the name the closure is bound to in its own frame
+    Symbol recursiveVariable;
+
+    // CseNode property for string nodes, shared with the strings it is sliced from or concatenated to
+    RpalString stringValue;
+
+    // CseNode property for integer nodes
+    Integer integerValue;
 
 public:
     CseNode() = default;
+    CseNode(const CseNode &) = default;
+    CseNode(CseNode &&) noexcept = default;
+    CseNode &operator=(const CseNode &) = default;
+    CseNode &operator=(CseNode &&) noexcept = default;
+
+    // the last owner of a tuple releases the tuples nested in it with an explicit stack, so deep tuples are handled
+    ~CseNode()
+    {
+        if (!listOfElements || listOfElements.use_count() != 1 || !owns_nested_tuple(*listOfElements))
+        {
+            return;
+        }
+
+        std::vector<std::shared_ptr<TupleElements>> pendingTuples;
+        pendingTuples.push_back(std::move(listOfElements));
+
+        while (!pendingTuples.empty())
+        {
+            std::shared_ptr<TupleElements> tuple = std::move(pendingTuples.back());
+            pendingTuples.pop_back();
+
+            int size = tuple->used.load(std::memory_order_relaxed);
+            for (int i = 0; i < size; i++)
+            {
+                CseNode &element = tuple->elements[i];
+                if (element.listOfElements && element.listOfElements.use_count() == 1)
+                {
+                    pendingTuples.push_back(std::move(element.listOfElements));
+                }
+            }
+        }
+    }
 
     // Constructor for lambda (in stack) and eeta nodes
-    CseNode(TypeOfObject typeOfNode, std::string valueOfNode, int csIndex, int environment)
+    CseNode(TypeOfObject typeOfNode, std::string valueOfNode, int csIndex, EnvironmentRef environment)
     {
         this->typeOfNode = typeOfNode;
         this->valueOfNode = std::move(valueOfNode);
         this->csIndex = csIndex;
-        this->environment = environment;
+        this->environment = std::move(environment);
     }
 
     // Constructor for lambda (in control structure) nodes
@@ -64,39 +323,86 @@ public:
         this->typeOfNode = typeOfNode;
         this->valueOfNode = std::move(valueOfNode);
         this->csIndex = csIndex;
+        if (typeOfNode == TypeOfObject::LAMBDA)
+        {
+            this->symbol = Symbol::intern(this->valueOfNode);
+        }
     }
 
     // Constructor for other nodes
     CseNode(TypeOfObject typeOfNode, std::string valueOfNode)
     {
         this->typeOfNode = typeOfNode;
-        this->valueOfNode = std::move(valueOfNode);
+        if (typeOfNode == TypeOfObject::STRING)
+        {
+            this->stringValue = RpalString(std::move(valueOfNode));
+        }
+        else if (typeOfNode == TypeOfObject::INTEGER)
+        {
+            this->integerValue = Integer::parse(valueOfNode);
+        }
+        else
+        {
+            this->valueOfNode = std::move(valueOfNode);
+        }
+
+        if (typeOfNode == TypeOfObject::IDENTIFIER || typeOfNode == TypeOfObject::BIND || typeOfNode == TypeOfObject::UNBIND)
+        {
+            this->symbol = Symbol::intern(this->valueOfNode);
+        }
+    }
+
+    // Constructor for string nodes
+    explicit CseNode(RpalString stringValue)
+    {
+        this->typeOfNode = TypeOfObject::STRING;
+        this->stringValue = std::move(stringValue);
+    }
+
+    // Constructor for integer nodes
+    explicit CseNode(Integer integerValue)
+    {
+        this->typeOfNode = TypeOfObject::INTEGER;
+        this->integerValue = std::move(integerValue);
     }
 
     // Constructor for lambda (in cs) nodes with bound variables
-    CseNode(TypeOfObject typeOfNode, int csIndex, std::vector<std::string> boundVariables)
+    CseNode(TypeOfObject typeOfNode, int csIndex, const std::vector<std::string> &boundVariables)
     {
         isOneBoundVariable = false;
         this->typeOfNode = typeOfNode;
         this->csIndex = csIndex;
-        this->boundVariables = std::move(boundVariables);
+
+        // a name given twice is bound to the later element, the earlier one is bound to no name
+        std::vector<Symbol> symbols;
+        for (std::size_t i = 0; i < boundVariables.size(); i++)
+        {
+            bool repeated = std::find(boundVariables.begin() + i + 1, boundVariables.end(), boundVariables[i]) !=
+                            boundVariables.end();
+            symbols.push_back(repeated ? Symbol() : Symbol::intern(boundVariables[i]));
+        }
+        this->boundVariables = std::make_shared<const std::vector<Symbol>>(std::move(symbols));
     }
 
-    // Constructor for lambda (in stack) nodes with bound variables
-    CseNode(TypeOfObject typeOfNode, int csIndex, std::vector<std::string> boundVariables, int environment)
+    // Constructor for superinstructions, the leaves they take their operands from are kept as their elements
+    CseNode(TypeOfObject typeOfNode, std::string valueOfNode, int csIndex, std::vector<CseNode> operands)
+        : CseNode(typeOfNode, std::move(operands))
     {
-        isOneBoundVariable = false;
-        this->typeOfNode = typeOfNode;
         this->valueOfNode = std::move(valueOfNode);
         this->csIndex = csIndex;
-        this->environment = environment;
-        this->boundVariables = std::move(boundVariables);
     }
 
+    // Constructor for list nodes, the elements of nested tuples are list nodes themselves
     CseNode(TypeOfObject typeOfNode, std::vector<CseNode> listOfElements)
     {
         this->typeOfNode = typeOfNode;
-        this->listOfElements = std::move(listOfElements);
+        this->listSize = static_cast<int>(listOfElements.size());
+        if (!listOfElements.empty())
+        {
+            this->listOfElements = std::make_shared<TupleElements>(listSize);
+            std::move(listOfElements.begin(), listOfElements.end(), this->listOfElements->elements.get());
+            this->listOfElements->used.store(listSize, std::memory_order_relaxed);
+        }
     }
 
     // Getters
@@ -107,10 +413,62 @@ public:
 
     std::string get_value_of_node() const
     {
+        if (typeOfNode == TypeOfObject::STRING)
+        {
+            return stringValue.str();
+        }
+        if (typeOfNode == TypeOfObject::INTEGER)
+        {
+            return integerValue.to_string();
+        }
+
         return valueOfNode;
     }
 
-    int get_environment() const
+    // node with only the type and value of this node, string nodes keep sharing their characters
+    CseNode value_copy() const
+    {
+        if (typeOfNode == TypeOfObject::STRING)
+        {
+            return CseNode(stringValue);
+        }
+        if (typeOfNode == TypeOfObject::INTEGER)
+        {
+            return CseNode(integerValue);
+        }
+
+        return CseNode(typeOfNode, valueOfNode);
+    }
+
+    // value of a string node, or the value of any other node as a string
+    RpalString get_string_value() const
+    {
+        if (typeOfNode == TypeOfObject::STRING)
+        {
+            return stringValue;
+        }
+
+        return RpalString(get_value_of_node());
+    }
+
+    // value of an integer node, the value of any other node is parsed as an integer
+    Integer get_integer_value() const
+    {
+        if (typeOfNode == TypeOfObject::INTEGER)
+        {
+            return integerValue;
+        }
+
+        return Integer::parse(get_value_of_node());
+    }
+
+    // value of a node known to be an integer node, neither checked nor copied
+    const Integer &integer_value() const
+    {
+        return integerValue;
+    }
+
+    const EnvironmentRef &get_environment() const
     {
         return environment;
     }
@@ -125,23 +483,144 @@ public:
         return isOneBoundVariable;
     }
 
-    std::vector<std::string> get_bound_variables_list() const
+    Symbol get_symbol() const
+    {
+        return symbol;
+    }
+
+    const std::vector<Symbol> &get_bound_variables_list() const
+    {
+        return boundVariables ? *boundVariables : noBoundVariables;
+    }
+
+    Span<CseNode> get_list_elements() const
+    {
+        return {listOfElements ? listOfElements->elements.get() : nullptr, static_cast<std::size_t>(listSize)};
+    }
+
+    /**
+     * Tuple of the elements of this tuple followed by the given element. The element is written in place after the
+     * elements when no other tuple made from this one has taken that place, so a chain of aug takes constant time
+     * for every element. Otherwise the elements are shared into a storage twice as large.
+     */
+    CseNode appended(CseNode element) const
+    {
+        CseNode tuple(TypeOfObject::LIST, std::vector<CseNode>());
+        tuple.listSize = listSize + 1;
+
+        if (listOfElements && listOfElements.use_count() == 1)
+        {
+            // the longer tuples made from this one are gone, their places can be taken again
+            int used = listOfElements->used.load(std::memory_order_relaxed);
+            for (int i = listSize; i < used; i++)
+            {
+                listOfElements->elements[i] = CseNode();
+            }
+            listOfElements->used.store(listSize, std::memory_order_relaxed);
+        }
+
+        int expected = listSize;
+        if (listOfElements && listSize < listOfElements->capacity &&
+            listOfElements->used.compare_exchange_strong(expected, listSize + 1, std::memory_order_acq_rel))
+        {
+            listOfElements->elements[listSize] = std::move(element);
+            tuple.listOfElements = listOfElements;
+            return tuple;
+        }
+
+        tuple.listOfElements = std::make_shared<TupleElements>(std::max(4, 2 * tuple.listSize));
+        for (int i = 0; i < listSize; i++)
+        {
+            tuple.listOfElements->elements[i] = listOfElements->elements[i];
+        }
+        tuple.listOfElements->elements[listSize] = std::move(element);
+        tuple.listOfElements->used.store(tuple.listSize, std::memory_order_relaxed);
+        return tuple;
+    }
+
+    int get_site() const
+    {
+        return site;
+    }
+
+    void set_site(int site_)
+    {
+        this->site = site_;
+    }
+
+    bool is_proven() const
     {
-        return boundVariables;
+        return proven;
     }
 
-    std::vector<CseNode> get_list_elements() const
+    void set_proven(bool proven_)
     {
-        return listOfElements;
+        this->proven = proven_;
     }
 
-    CseNode set_env(int environment_)
+    // leaves a superinstruction takes its operands from, in the order of the nodes it was fused from
+    Span<CseNode> get_operands() const
     {
-        this->environment = environment_;
+        return get_list_elements();
+    }
+
+    Symbol get_recursive_variable() const
+    {
+        return recursiveVariable;
+    }
+
+    // turn a lambda (in cs) node into a rec lambda node that binds itself to the given name
+    CseNode set_recursive(const std::string &recursiveVariable_)
+    {
+        this->typeOfNode = TypeOfObject::REC_LAMBDA;
+        this->recursiveVariable = Symbol::intern(recursiveVariable_);
+        return *this;
+    }
+
+    // closure built from a rec lambda node for the given environment
+    CseNode to_closure(EnvironmentRef environment_) const
+    {
+        CseNode closure = as_closure(TypeOfObject::LAMBDA);
+        closure.recursiveVariable = Symbol();
+        closure.environment = std::move(environment_);
+        return closure;
+    }
+
+    // the same closure as a lambda or eeta node, the bound variables stay shared
+    CseNode as_closure(TypeOfObject typeOfNode_) const
+    {
+        CseNode closure = *this;
+        closure.typeOfNode = typeOfNode_;
+        return closure;
+    }
+
+    CseNode set_env(EnvironmentRef environment_)
+    {
+        this->environment = std::move(environment_);
         return *this;
     }
+
+private:
+    static const std::vector<Symbol> noBoundVariables;
+
+    // whether releasing the elements releases a tuple too
+    static bool owns_nested_tuple(const TupleElements &tuple)
+    {
+        int size = tuple.used.load(std::memory_order_relaxed);
+        for (int i = 0; i < size; i++)
+        {
+            const CseNode &element = tuple.elements[i];
+            if (element.listOfElements && element.listOfElements.use_count() == 1)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
 };
 
+const std::vector<Symbol> CseNode::noBoundVariables;
+
 class ControlStructure
 {
 private:
@@ -158,7 +637,14 @@ public:
     // add node to control structure
     void append_node(CseNode node)
     {
-        nodes.push_back(node);
+        nodes.push_back(std::move(node));
+    }
+
+    // construct a node in place at the end of the control structure
+    template <typename... Args>
+    void emplace_node(Args &&...args)
+    {
+        nodes.emplace_back(std::forward<Args>(args)...);
     }
 
     // Getters
@@ -173,6 +659,12 @@ public:
         return nodes.back();
     }
 
+    // the nodes of the control structure, the last one is evaluated first
+    const std::vector<CseNode> &get_nodes() const
+    {
+        return nodes;
+    }
+
     // pop the last node in the control structure
     void pop_last_node()
     {
@@ -182,7 +674,7 @@ public:
     // pop and return the last node in the control structure
     CseNode pop_last_node_return()
     {
-        CseNode node = nodes.back();
+        CseNode node = std::move(nodes.back());
         nodes.pop_back();
         return node;
     }
@@ -207,9 +699,15 @@ public:
     Stack() = default;
 
     // add node to stack
-    void append_node(const CseNode &node)
+    void append_node(CseNode node)
+    {
+        nodes.push_back(std::move(node));
+    }
+
+    // the last node in the stack
+    const CseNode &get_last_node() const
     {
-        nodes.push_back(node);
+        return nodes.back();
     }
 
     // pop the last node in the stack
@@ -218,14 +716,29 @@ public:
         nodes.pop_back();
     }
 
-    // pop and return the last node in the stack
+    // pop and return the last node in the stack, a program that uses the value of Print finds none
     CseNode pop_last_node_return()
     {
-        CseNode node = nodes.back();
+        if (nodes.empty())
+        {
+            throw std::runtime_error("No value on the stack");
+        }
+
+        CseNode node = std::move(nodes.back());
         nodes.pop_back();
         return node;
     }
 
+    // move all the nodes of another stack on top of this one, in the same order
+    void take_all(Stack &other)
+    {
+        for (CseNode &node : other.nodes)
+        {
+            nodes.push_back(std::move(node));
+        }
+        other.nodes.clear();
+    }
+
     // length of the stack
     int length() const
     {
@@ -233,975 +746,2853 @@ public:
     }
 };
 
-class Environment
+// Kinds of bindings of an environment, a name is looked up as a variable, then as a lambda, then as a list
+enum class BindingKind : int
 {
-private:
-    std::unordered_map<std::string, CseNode> variables;
-    std::unordered_map<std::string, CseNode> lambdas;
-    std::unordered_map<std::string, std::vector<CseNode>> lists;
-    bool isLambda = false;
-    Environment *parentEnvironment;
+    VARIABLE,
+    LAMBDA,
+    LIST
+};
 
+/**
+ * Bindings of a call, of the captures of a closure or of the program. Most environments bind one or two names, so
+ * the first INLINE_BINDINGS bindings are kept in the environment itself. Environments with more bindings, such as
+ * those of large tuple parameters and of closures with many free variables, move all of them to a vector, which
+ * is searched linearly up to LINEAR_BINDINGS bindings and through a hash table of their positions beyond that.
+ */
+class Environment
+{
 public:
-    // constructor with empty variables and lambdas
-    Environment()
-    {
-        parentEnvironment = nullptr;
-    }
-
-    // constructor with empty variables and lambdas
-    explicit Environment(Environment *parentEnvironment)
-    {
-        this->parentEnvironment = parentEnvironment;
-    }
+    static const int INLINE_BINDINGS = 2;
+    static const std::size_t LINEAR_BINDINGS = 16;
 
-    // add variable to environment
-    void append_variable(const std::string &identifier, const CseNode &nodeValue)
+private:
+    struct Binding
     {
-        variables[identifier] = nodeValue;
-    }
+        Symbol symbol;
+        BindingKind kind = BindingKind::VARIABLE;
+        CseNode value;
+    };
 
-    void append_variables(const std::vector<std::string> &identifiers,
-                          const std::vector<CseNode> &values)
+    struct BindingHash
     {
-        for (int i = 0; i < identifiers.size(); i++)
+        std::size_t operator()(const std::pair<Symbol, BindingKind> &key) const
         {
-            variables[identifiers[i]] = values[i];
+            return key.first.hash() * 3 + static_cast<std::size_t>(key.second);
         }
-    }
+    };
 
-    void append_list(const std::string &identifier, std::vector<CseNode> listOfElements)
-    {
-        lists[identifier] = std::move(listOfElements);
-    }
+    static_assert(std::is_nothrow_move_constructible<CseNode>::value,
+                  "bindings are moved when moreBindings grows, an uncounted reference must stay uncounted");
 
-    // add lambda to environment
-    void append_lambda(const std::string &identifier, const CseNode &lambda)
-    {
-        isLambda = true;
+    using BindingIndex = std::unordered_map<std::pair<Symbol, BindingKind>, std::size_t, BindingHash>;
 
-        // check the node type and create new object
-        if (lambda.get_type_of_node() == TypeOfObject::LAMBDA)
-        {
-            if (lambda.get_is_one_bound_var())
-            {
-                lambdas[identifier] = CseNode(TypeOfObject::LAMBDA,
-                                              lambda.get_value_of_node(), lambda.get_cs_index(), lambda.get_environment());
-            }
-            else
-            {
-                lambdas[identifier] = CseNode(TypeOfObject::LAMBDA, lambda.get_cs_index(),
-                                              lambda.get_bound_variables_list(), lambda.get_environment());
-            }
-        }
-        else if (lambda.get_type_of_node() == TypeOfObject::EETA)
+    Binding inlineBindings[INLINE_BINDINGS];
+    int inlineCount = 0;
+    std::vector<Binding> moreBindings;     // all the bindings once there are more than INLINE_BINDINGS
+    std::unique_ptr<BindingIndex> index;   // positions in moreBindings once there are more than LINEAR_BINDINGS
+    bool large = false;                    // the bindings are in moreBindings
+    EnvironmentRef parentEnvironment;
+    std::atomic<int> references{0}; // counted references to a heap environment, frames are not counted
+    int label = 0;                   // number of the environment, only used to tell environments apart when printing
+
+    friend class EnvironmentRef;
+
+    // Environment is not copyable, closures refer to it
+    Environment(const Environment &) = delete;
+    Environment &operator=(const Environment &) = delete;
+
+    // position of a binding in moreBindings, moreBindings.size() when there is none
+    std::size_t position(Symbol symbol, BindingKind kind) const
+    {
+        if (index)
         {
-            if (lambda.get_is_one_bound_var())
-            {
-                lambdas[identifier] = CseNode(TypeOfObject::EETA,
-                                              lambda.get_value_of_node(), lambda.get_cs_index(), lambda.get_environment());
-            }
-            else
-            {
-                lambdas[identifier] = CseNode(TypeOfObject::EETA, lambda.get_cs_index(),
-                                              lambda.get_bound_variables_list(), lambda.get_environment());
-            }
+            auto it = index->find({symbol, kind});
+            return it != index->end() ? it->second : moreBindings.size();
         }
-        else
+
+        std::size_t i = 0;
+        while (i < moreBindings.size() && (moreBindings[i].symbol != symbol || moreBindings[i].kind != kind))
         {
-            throw std::runtime_error("Invalid lambda node type");
+            i++;
         }
+        return i;
     }
 
-    // get variable from environment
-    CseNode get_variable(const std::string &identifier)
+    CseNode *find_here(Symbol symbol, BindingKind kind)
     {
-        if (variables.find(identifier) != variables.end())
-        {
-            return variables[identifier];
-        }
-        else if (parentEnvironment != nullptr)
+        if (large)
         {
-            return parentEnvironment->get_variable(identifier);
+            std::size_t i = position(symbol, kind);
+            return i < moreBindings.size() ? &moreBindings[i].value : nullptr;
         }
-        else
+
+        for (int i = 0; i < inlineCount; i++)
         {
-            throw std::runtime_error("Identifier: " + identifier + " is not found");
+            if (inlineBindings[i].symbol == symbol && inlineBindings[i].kind == kind)
+            {
+                return &inlineBindings[i].value;
+            }
         }
+        return nullptr;
+    }
+
+    const CseNode *find_here(Symbol symbol, BindingKind kind) const
+    {
+        return const_cast<Environment *>(this)->find_here(symbol, kind);
     }
 
-    // get lambda from environment
-    CseNode get_lambda(const std::string &identifier)
+    void bind(Symbol symbol, BindingKind kind, CseNode value)
     {
-        if (lambdas.find(identifier) != lambdas.end())
+        if (CseNode *bound = find_here(symbol, kind))
         {
-            return lambdas[identifier];
+            *bound = std::move(value);
+            return;
         }
-        else if (parentEnvironment != nullptr)
+
+        if (!large && inlineCount < INLINE_BINDINGS)
         {
-            return parentEnvironment->get_lambda(identifier);
+            inlineBindings[inlineCount++] = {symbol, kind, std::move(value)};
+            return;
         }
-        else
+
+        if (!large)
+        {
+            for (int i = 0; i < inlineCount; i++)
+            {
+                moreBindings.push_back(std::move(inlineBindings[i]));
+                inlineBindings[i].value = CseNode();
+            }
+            inlineCount = 0;
+            large = true;
+        }
+
+        moreBindings.push_back({symbol, kind, std::move(value)});
+        if (index)
         {
-            throw std::runtime_error("Identifier: " + identifier + " is not found");
+            index->emplace(std::make_pair(symbol, kind), moreBindings.size() - 1);
+        }
+        else if (moreBindings.size() > LINEAR_BINDINGS)
+        {
+            index = std::make_unique<BindingIndex>();
+            for (std::size_t i = 0; i < moreBindings.size(); i++)
+            {
+                index->emplace(std::make_pair(moreBindings[i].symbol, moreBindings[i].kind), i);
+            }
         }
     }
 
-    // get list from environment
-    std::vector<CseNode> get_list(const std::string &identifier)
+    void unbind(Symbol symbol, BindingKind kind)
     {
-        if (lists.find(identifier) != lists.end())
+        if (large)
+        {
+            std::size_t i = position(symbol, kind);
+            if (i == moreBindings.size())
+            {
+                return;
+            }
+
+            // the last binding takes the place of the one removed
+            if (index)
+            {
+                index->erase({symbol, kind});
+                if (i + 1 < moreBindings.size())
+                {
+                    (*index)[{moreBindings.back().symbol, moreBindings.back().kind}] = i;
+                }
+            }
+            moreBindings[i] = std::move(moreBindings.back());
+            moreBindings.pop_back();
+            return;
+        }
+
+        for (int i = 0; i < inlineCount; i++)
         {
-            return lists[identifier];
+            if (inlineBindings[i].symbol == symbol && inlineBindings[i].kind == kind)
+            {
+                inlineBindings[i] = std::move(inlineBindings[inlineCount - 1]);
+                inlineBindings[--inlineCount].value = CseNode();
+                return;
+            }
         }
-        else if (parentEnvironment != nullptr)
+    }
+
+    void restore_entry(Symbol symbol, BindingKind kind, std::optional<CseNode> &saved)
+    {
+        if (saved)
         {
-            return parentEnvironment->get_list(identifier);
+            bind(symbol, kind, std::move(*saved));
         }
         else
         {
-            throw std::runtime_error("Identifier: " + identifier + " is not found");
+            unbind(symbol, kind);
         }
     }
-};
 
-class CSE
-{
-private:
-    int nextEnvironment = 0;
-    int nextCS = -1;
+public:
+    // constructor with no bindings
+    Environment() = default;
 
-    std::vector<ControlStructure *> ControlStructs;
-    ControlStructure main_cs = ControlStructure(-1);
-    Stack stack = Stack();
-    std::vector<int> environment_stack = std::vector<int>();
-    std::unordered_map<int, Environment *> environments = std::unordered_map<int, Environment *>();
+    // constructor with no bindings
+    Environment(EnvironmentRef parentEnvironment, int label)
+        : parentEnvironment(std::move(parentEnvironment)), label(label) {}
 
-public:
-    // constructor with empty control structures and stack
-    CSE() = default;
+    // start using a frame that has no bindings
+    void enter(EnvironmentRef parentEnvironment, int label)
+    {
+        this->parentEnvironment = std::move(parentEnvironment);
+        this->label = label;
+    }
+
+    // release the bindings of a frame when its call returns, the vector keeps its capacity
+    void leave()
+    {
+        for (int i = 0; i < inlineCount; i++)
+        {
+            inlineBindings[i].value = CseNode();
+        }
+        inlineCount = 0;
+        moreBindings.clear();
+        index.reset();
+        large = false;
+        parentEnvironment = EnvironmentRef();
+    }
+
+    int get_label() const
+    {
+        return label;
+    }
+
+    // add variable to environment
+    void append_variable(Symbol identifier, const CseNode &nodeValue)
+    {
+        bind(identifier, BindingKind::VARIABLE, nodeValue);
+    }
 
-    // create control structures
-    void create_cs(CustomTreeNode *root, ControlStructure *current_cs = nullptr, int current_cs_index = -1)
+    // add tuple to environment, the tuple keeps sharing its elements
+    void append_list(Symbol identifier, CseNode list)
     {
-        ControlStructure *cs;
+        bind(identifier, BindingKind::LIST, std::move(list));
+    }
 
-        if (nextCS == -1)
+    // add lambda to environment
+    void append_lambda(Symbol identifier, CseNode lambda)
+    {
+        // check the node type
+        if (lambda.get_type_of_node() == TypeOfObject::LAMBDA || lambda.get_type_of_node() == TypeOfObject::EETA)
         {
-            nextCS++;
-            cs = new ControlStructure(nextCS++);
-            ControlStructs.push_back(cs);
-            current_cs_index = 0;
+            bind(identifier, BindingKind::LAMBDA, std::move(lambda));
         }
         else
         {
-            cs = current_cs;
+            throw std::runtime_error("Invalid lambda node type");
         }
+    }
+
+    /**
+     * Binds the elements of a tuple to the variables of a tuple parameter. The variables are distinct and there
+     * are as many of them as elements, so a small tuple bound in an environment without bindings is copied
+     * straight into the inline bindings. A curried call binds its earlier arguments in the same frame first,
+     * then the elements are added to them.
+     */
+    void bind_elements(const std::vector<Symbol> &variables, Span<CseNode> elements)
+    {
+        bool small = !large && inlineCount == 0 && variables.size() <= static_cast<std::size_t>(INLINE_BINDINGS);
 
-        if (root->getLabel() == "lambda")
+        for (std::size_t i = 0; i < variables.size(); i++)
         {
-            CseNode *lambda;
-            if (root->getChildren()[0]->getLabel() == ",")
+            BindingKind kind = elements[i].get_type_of_node() == TypeOfObject::LIST     ? BindingKind::LIST
+                               : elements[i].get_type_of_node() == TypeOfObject::LAMBDA ? BindingKind::LAMBDA
+                                                                                        : BindingKind::VARIABLE;
+            if (small)
             {
-                std::vector<std::string> vars;
-                for (auto &child : root->getChildren()[0]->getChildren())
-                {
-                    vars.push_back(child->getValue());
-                }
-                lambda = new CseNode(TypeOfObject::LAMBDA, nextCS, vars);
+                inlineBindings[i] = {variables[i], kind, elements[i]};
             }
             else
             {
-                std::string var = root->getChildren()[0]->getValue();
-                lambda = new CseNode(TypeOfObject::LAMBDA, var, nextCS);
+                bind(variables[i], kind, elements[i]);
             }
+        }
+
+        if (small)
+        {
+            inlineCount = static_cast<int>(variables.size());
+        }
+    }
 
-            cs->append_node(*lambda);
+    // the bindings of a name in an environment, kept while a binding compiled into the frame hides them
+    struct SavedBinding
+    {
+        Symbol identifier;
+        std::optional<CseNode> variable;
+        std::optional<CseNode> lambda;
+        std::optional<CseNode> list;
+    };
+
+    // save the bindings of a name before the name is bound again in this environment
+    SavedBinding save_binding(Symbol identifier) const
+    {
+        SavedBinding saved{identifier, std::nullopt, std::nullopt, std::nullopt};
 
-            auto *new_cs = new ControlStructure(nextCS);
-            ControlStructs.push_back(new_cs);
-            create_cs(root->getChildren()[1], new_cs, nextCS++);
+        if (const CseNode *variable = find_here(identifier, BindingKind::VARIABLE))
+        {
+            saved.variable = *variable;
+        }
+        if (const CseNode *lambda = find_here(identifier, BindingKind::LAMBDA))
+        {
+            saved.lambda = *lambda;
         }
-        else if (root->getLabel() == "tau")
+        if (const CseNode *list = find_here(identifier, BindingKind::LIST))
         {
-            auto *tau = new CseNode(TypeOfObject::TAU, std::to_string(root->getChildren().size()));
-            cs->append_node(*tau);
+            saved.list = *list;
+        }
+
+        return saved;
+    }
+
+    // put back the bindings of a name saved by save_binding
+    void restore_binding(SavedBinding &saved)
+    {
+        restore_entry(saved.identifier, BindingKind::VARIABLE, saved.variable);
+        restore_entry(saved.identifier, BindingKind::LAMBDA, saved.lambda);
+        restore_entry(saved.identifier, BindingKind::LIST, saved.list);
+    }
 
-            for (auto &child : root->getChildren())
+    // copy the bindings of a name that are visible from another environment, the first one of each kind
+    void capture(Symbol identifier, const Environment &environment)
+    {
+        for (BindingKind kind : {BindingKind::VARIABLE, BindingKind::LAMBDA, BindingKind::LIST})
+        {
+            if (const CseNode *value = environment.find(identifier, kind))
             {
-                create_cs(child, cs, current_cs_index);
+                bind(identifier, kind, *value);
             }
         }
-        else if (root->getLabel() == "->")
+    }
+
+    // find a binding of the given kind in this environment or its parents, nullptr when there is none
+    const CseNode *find(Symbol identifier, BindingKind kind) const
+    {
+        for (const Environment *environment = this; environment != nullptr; environment = environment->parentEnvironment.get())
         {
-            int then_index = nextCS++;
-            int else_index = nextCS++;
-            auto *delta_then = new CseNode(TypeOfObject::DELTA, std::to_string(then_index));
-            auto *delta_else = new CseNode(TypeOfObject::DELTA, std::to_string(else_index));
-            auto *beta = new CseNode(TypeOfObject::BETA, "");
+            if (const CseNode *value = environment->find_here(identifier, kind))
+            {
+                return value;
+            }
+        }
 
-            cs->append_node(*delta_then);
-            cs->append_node(*delta_else);
-            cs->append_node(*beta);
+        return nullptr;
+    }
+};
 
-            auto *then_cs = new ControlStructure(then_index);
-            auto *else_cs = new ControlStructure(else_index);
+inline void EnvironmentRef::acquire(Environment *environment)
+{
+    if (environment != nullptr)
+    {
+        environment->references.fetch_add(1, std::memory_order_relaxed);
+    }
+}
 
-            ControlStructs.push_back(then_cs);
-            ControlStructs.push_back(else_cs);
+/**
+ * Releasing an environment releases the closures bound in it and so possibly their environments, which are deleted
+ * one after the other instead of recursively, since closures can be nested as deep as the program likes.
+ */
+inline void EnvironmentRef::release(Environment *environment)
+{
+    if (environment == nullptr || environment->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
 
-            create_cs(root->getChildren()[1], then_cs, then_index);
-            create_cs(root->getChildren()[2], else_cs, else_index);
+    thread_local std::vector<Environment *> unreferenced; // released while another environment is deleted
+    thread_local bool releasing = false;
+    if (releasing)
+    {
+        unreferenced.push_back(environment);
+        return;
+    }
 
-            create_cs(root->getChildren()[0], cs, current_cs_index);
-        }
-        else if (is_operator(root->getLabel()))
+    releasing = true;
+    delete environment;
+    while (!unreferenced.empty())
+    {
+        Environment *next = unreferenced.back();
+        unreferenced.pop_back();
+        delete next;
+    }
+    releasing = false;
+}
+
+/**
+ * Results of calls of pure functions for -memoize. A call is identified by its closure, that is the index of the body
+ * and the environment, and by the value of its argument, which is compared and hashed structurally. Only integers,
+ * strings, truth values and tuples of them are used as arguments. When the table is full the entry used least
+ * recently is dropped.
+ */
+class MemoTable
+{
+public:
+    struct Key
+    {
+        int csIndex;
+        EnvironmentRef environment;
+        CseNode argument;
+    };
+
+private:
+    struct KeyHash
+    {
+        std::size_t operator()(const Key *key) const
         {
-            auto *op = new CseNode(TypeOfObject::OPERATOR, root->getLabel());
-            cs->append_node(*op);
+            std::size_t hash = hash_value(key->argument);
+            hash = hash * 31 + std::hash<int>()(key->csIndex);
+            return hash * 31 + std::hash<Environment *>()(key->environment.get());
+        }
+    };
 
-            for (auto &child : root->getChildren())
-            {
-                create_cs(child, cs, current_cs_index);
-            }
+    struct KeyEqual
+    {
+        bool operator()(const Key *first, const Key *second) const
+        {
+            return first->csIndex == second->csIndex && first->environment == second->environment &&
+                   equal_values(first->argument, second->argument);
         }
-        else if (root->getLabel() == "gamma")
+    };
+
+    using Entry = std::pair<Key, CseNode>;
+
+    std::size_t capacity;
+    std::list<Entry> entries; // the entry used most recently first
+    std::unordered_map<const Key *, std::list<Entry>::iterator, KeyHash, KeyEqual> index; // keys point into entries
+
+public:
+    static const std::size_t DEFAULT_CAPACITY = 1 << 16;
+
+    explicit MemoTable(std::size_t capacity) : capacity(capacity) {}
+
+    // whether a value can be an argument of a memoized call, tuples are walked with an explicit stack
+    static bool is_key(const CseNode &value)
+    {
+        std::vector<const CseNode *> pending = {&value};
+
+        while (!pending.empty())
         {
-            auto *gamma = new CseNode(TypeOfObject::GAMMA, "");
-            cs->append_node(*gamma);
+            const CseNode &node = *pending.back();
+            pending.pop_back();
 
-            for (auto &child : root->getChildren())
+            if (node.get_type_of_node() == TypeOfObject::LIST)
+            {
+                for (const CseNode &element : node.get_list_elements())
+                {
+                    pending.push_back(&element);
+                }
+            }
+            else if (node.get_type_of_node() != TypeOfObject::INTEGER && node.get_type_of_node() != TypeOfObject::STRING &&
+                     node.get_type_of_node() != TypeOfObject::BOOLEAN)
             {
-                create_cs(child, cs, current_cs_index);
+                return false;
             }
         }
-        else if (root->getLabel() == "identifier" || root->getLabel() == "integer" || root->getLabel() == "string")
+
+        return true;
+    }
+
+    // hash of a value accepted by is_key, equal values have equal hashes
+    static std::size_t hash_value(const CseNode &value)
+    {
+        std::size_t hash = 0;
+        std::vector<const CseNode *> pending = {&value};
+
+        while (!pending.empty())
         {
-            std::string value = root->getValue();
-            std::string type = root->getLabel();
-            CseNode *leaf;
+            const CseNode &node = *pending.back();
+            pending.pop_back();
 
-            if (type == "identifier")
+            std::size_t part;
+            if (node.get_type_of_node() == TypeOfObject::LIST)
             {
-                leaf = new CseNode(TypeOfObject::IDENTIFIER, value);
+                Span<CseNode> elements = node.get_list_elements();
+                part = elements.size();
+                for (std::size_t i = elements.size(); i > 0; i--)
+                {
+                    pending.push_back(&elements[i - 1]);
+                }
             }
-            else if (type == "integer")
+            else if (node.get_type_of_node() == TypeOfObject::INTEGER)
             {
-                leaf = new CseNode(TypeOfObject::INTEGER, value);
+                part = node.get_integer_value().hash();
             }
-            else if (type == "string")
+            else if (node.get_type_of_node() == TypeOfObject::STRING)
             {
-                leaf = new CseNode(TypeOfObject::STRING, value);
+                part = std::hash<std::string_view>()(node.get_string_value().view());
             }
             else
             {
-                throw std::runtime_error("Invalid leaf type: " + type);
+                part = std::hash<std::string>()(node.get_value_of_node());
             }
 
-            cs->append_node(*leaf);
-        }
-        else
-        {
-            throw std::runtime_error("Invalid node type: " + root->getLabel() + "Value: " + root->getValue());
+            hash = hash * 31 + static_cast<std::size_t>(node.get_type_of_node());
+            hash = hash * 31 + part;
         }
+
+        return hash;
     }
 
-    void evaluate()
+    // structural equality of values accepted by is_key
+    static bool equal_values(const CseNode &first, const CseNode &second)
     {
-        auto *e0 = new CseNode(TypeOfObject::ENVIRONMENT, "0");
-        main_cs.append_node(*e0);
-        stack.append_node(*e0);
-        environment_stack.push_back(nextEnvironment++);
-        environments[0] = new Environment(nullptr);
+        std::vector<std::pair<const CseNode *, const CseNode *>> pending = {{&first, &second}};
 
-        main_cs.push_cs(*ControlStructs[0]);
-
-        CseNode top_of_cs = main_cs.pop_last_node_return();
-
-        while ((top_of_cs.get_type_of_node() != TypeOfObject::ENVIRONMENT) || (top_of_cs.get_value_of_node() != "0"))
+        while (!pending.empty())
         {
-            if (top_of_cs.get_type_of_node() == TypeOfObject::INTEGER || top_of_cs.get_type_of_node() == TypeOfObject::STRING)
+            const CseNode &a = *pending.back().first;
+            const CseNode &b = *pending.back().second;
+            pending.pop_back();
+
+            if (a.get_type_of_node() != b.get_type_of_node())
             {
-                stack.append_node(top_of_cs);
-                top_of_cs = main_cs.pop_last_node_return();
+                return false;
             }
-            else if (top_of_cs.get_type_of_node() == TypeOfObject::IDENTIFIER)
-            {
-                CseNode nodeValue;
-                CseNode value_l;
-                std::vector<CseNode> list;
 
-                try
+            if (a.get_type_of_node() == TypeOfObject::LIST)
+            {
+                Span<CseNode> aElements = a.get_list_elements();
+                Span<CseNode> bElements = b.get_list_elements();
+                if (aElements.size() != bElements.size())
                 {
-                    nodeValue = environments[environment_stack.back()]->get_variable(top_of_cs.get_value_of_node());
-                    stack.append_node(CseNode(nodeValue.get_type_of_node(), nodeValue.get_value_of_node()));
+                    return false;
                 }
-                catch (std::runtime_error &e)
+                for (std::size_t i = 0; i < aElements.size(); i++)
                 {
-                    try
-                    {
-                        value_l = environments[environment_stack.back()]->get_lambda(top_of_cs.get_value_of_node());
-                        stack.append_node(value_l);
-                    }
-                    catch (std::runtime_error &e)
-                    {
-                        try
-                        {
-                            list = environments[environment_stack.back()]->get_list(top_of_cs.get_value_of_node());
-                            stack.append_node(CseNode(TypeOfObject::LIST, list));
-                        }
-                        catch (std::runtime_error &e)
-                        {
-                            // if node nodeValue is in builtInFunctions add the node to the stack
-                            if (std::find(builtInFunctions.begin(), builtInFunctions.end(),
-                                          top_of_cs.get_value_of_node()) !=
-                                builtInFunctions.end())
-                            {
-                                stack.append_node(top_of_cs);
-                            }
-                            else if (top_of_cs.get_value_of_node() == "nil")
-                            {
-                                stack.append_node(CseNode(TypeOfObject::LIST, std::vector<CseNode>()));
-                            }
-                            else
-                            {
-                                throw std::runtime_error("Variable not found: " + top_of_cs.get_value_of_node());
-                            }
-                        }
-                    }
+                    pending.emplace_back(&aElements[i], &bElements[i]);
                 }
-
-                top_of_cs = main_cs.pop_last_node_return();
             }
-            else if (top_of_cs.get_type_of_node() == TypeOfObject::LAMBDA)
+            else if (a.get_type_of_node() == TypeOfObject::INTEGER)
             {
-                int current_env = environment_stack.back();
-                stack.append_node(top_of_cs.set_env(current_env));
-
-                top_of_cs = main_cs.pop_last_node_return();
+                if (a.get_integer_value() != b.get_integer_value())
+                {
+                    return false;
+                }
             }
-            else if (top_of_cs.get_type_of_node() == TypeOfObject::GAMMA)
+            else if (a.get_type_of_node() == TypeOfObject::STRING)
             {
-                CseNode top_of_stack = stack.pop_last_node_return();
-
-                if (top_of_stack.get_type_of_node() == TypeOfObject::LAMBDA)
+                if (a.get_string_value() != b.get_string_value())
                 {
-                    Environment *new_environment = new Environment(environments[top_of_stack.get_environment()]);
-                    environments[nextEnvironment++] = new_environment;
+                    return false;
+                }
+            }
+            else if (a.get_value_of_node() != b.get_value_of_node())
+            {
+                return false;
+            }
+        }
 
-                    CseNode nodeValue = stack.pop_last_node_return();
+        return true;
+    }
 
-                    if (nodeValue.get_type_of_node() == TypeOfObject::LAMBDA || nodeValue.get_type_of_node() == TypeOfObject::EETA)
-                    {
-                        new_environment->append_lambda(top_of_stack.get_value_of_node(), nodeValue);
-                    }
-                    else if (nodeValue.get_type_of_node() == TypeOfObject::STRING || nodeValue.get_type_of_node() == TypeOfObject::INTEGER)
-                    {
-                        new_environment->append_variable(top_of_stack.get_value_of_node(), nodeValue);
-                    }
-                    else if (nodeValue.get_type_of_node() == TypeOfObject::LIST && !top_of_stack.get_is_one_bound_var())
-                    {
+    // the result of a call, nullptr when it is not in the table
+    const CseNode *find(const Key &key)
+    {
+        auto it = index.find(&key);
+        if (it == index.end())
+        {
+            return nullptr;
+        }
 
-                        std::vector<std::string> variable_list = top_of_stack.get_bound_variables_list();
-                        std::vector<CseNode> list_items = nodeValue.get_list_elements();
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->second;
+    }
 
-                        std::vector<CseNode> temporary_list = std::vector<CseNode>();
+    // add the result of a call that is not in the table
+    void insert(Key key, CseNode result)
+    {
+        if (capacity == 0 || index.count(&key) != 0)
+        {
+            return;
+        }
 
-                        int variable_count = 0;
+        if (entries.size() == capacity)
+        {
+            index.erase(&entries.back().first);
+            entries.pop_back();
+        }
 
-                        int list_element_count = 0;
-                        bool create_list = false;
+        entries.emplace_front(std::move(key), std::move(result));
+        index.emplace(&entries.front().first, entries.begin());
+    }
+};
 
-                        for (const auto &i : list_items)
-                        {
-                            if (create_list)
-                            {
-                                temporary_list.push_back(i);
-                                list_element_count--;
-
-                                if (list_element_count == 0)
-                                {
-                                    new_environment->append_list(variable_list[variable_count++], temporary_list);
-                                    temporary_list = std::vector<CseNode>();
-                                    create_list = false;
-                                }
-                            }
-                            else
-                            {
-                                if (i.get_type_of_node() == TypeOfObject::LIST)
-                                {
-                                    list_element_count = std::stoi(i.get_value_of_node());
-                                    if (list_element_count == 0)
-                                    {
-                                        new_environment->append_list(variable_list[variable_count++], temporary_list);
-                                        temporary_list = std::vector<CseNode>();
-                                    }
-                                    else
-                                    {
-                                        create_list = true;
-                                    }
-                                }
-                                else if (i.get_type_of_node() == TypeOfObject::LAMBDA)
-                                {
-                                    new_environment->append_lambda(variable_list[variable_count++], i);
-                                }
-                                else
-                                {
-                                    new_environment->append_variable(variable_list[variable_count++], i);
-                                }
-                            }
-                        }
+class CSE
+{
+private:
+    static const int MAX_PARALLEL_NESTING = 32; // machines nested deeper than this evaluate components in place
 
-                        if (create_list)
-                        {
-                            new_environment->append_list(variable_list[variable_count], temporary_list);
-                        }
-                    }
-                    else if (nodeValue.get_type_of_node() == TypeOfObject::LIST)
-                    {
-                        new_environment->append_list(top_of_stack.get_value_of_node(), nodeValue.get_list_elements());
-                    }
-                    else
-                    {
-                        throw std::runtime_error("Invalid object for gamma: " + nodeValue.get_value_of_node());
-                    }
+    // machines evaluating components of parallel and speculate nodes share the control structures of the machine
+    // evaluating the program, and the environments of the machines they were started from
+    CSE *root_machine = this;
+    CSE *parent_machine = nullptr;
+    int nesting = 0; // number of machines between this one and root_machine
 
-                    environment_stack.push_back(nextEnvironment - 1);
-                    auto *environment_obj = new CseNode(TypeOfObject::ENVIRONMENT, std::to_string(nextEnvironment - 1));
-                    main_cs.append_node(*environment_obj);
-                    stack.append_node(*environment_obj);
-                    main_cs.push_cs(*ControlStructs[top_of_stack.get_cs_index()]);
-                }
-                else if (top_of_stack.get_type_of_node() == TypeOfObject::IDENTIFIER)
-                {
+    int nextCS = -1;
+    int componentOffset = 0; // index of the control structure of the first parallel component
+    std::vector<ControlStructure> components; // components of PARALLEL nodes while create_cs runs, numbered -1, -2, ...
 
-                    std::string identifier = top_of_stack.get_value_of_node();
-
-                    if (identifier == "Print" || identifier == "print") {
-                    CseNode value = stack.pop_last_node_return();
-                    std::vector<CseNode> list_elements = value.get_list_elements();
-
-                    if (value.get_type_of_node() == TypeOfObject::LIST) {
-                        std::cout << "(";
-
-                        std::vector<int> count_stack;
-
-                        for (int i = 0; i < value.get_list_elements().size(); i++) {
-                            if (list_elements[i].get_type_of_node() == TypeOfObject::LIST) {
-                                if (std::stoi(list_elements[i].get_value_of_node()) == 0) {
-                                    if (i == list_elements.size() - 1) {
-                                        std::cout << "nil";
-                                    } else {
-                                        std::cout << "nil, ";
-                                    }
-                                } else {
-                                    for (int &count: count_stack) {
-                                        count--;
-                                    }
-
-                                    count_stack.push_back(std::stoi(list_elements[i].get_value_of_node()));
-                                    std::cout << "(";
-                                }
-                            } else {
-                                std::cout << list_elements[i].get_value_of_node();
-
-                                if (!count_stack.empty()) {
-                                    // reduce 1 from all elements in count_stack
-                                    for (int &count: count_stack) {
-                                        count--;
-                                    }
-
-                                    if (count_stack[count_stack.size() - 1] == 0) {
-                                        int finished_lists = 0;
-
-                                        while (count_stack[count_stack.size() - 1] == 0) {
-                                            finished_lists++;
-                                            count_stack.pop_back();
-                                        }
-                                        if (i != value.get_list_elements().size() - 1) {
-                                            for (int j = 0; j < finished_lists - 1; j++) {
-                                                std::cout << ")";
-                                            }
-
-                                            std::cout << "), ";
-                                        } else {
-                                            for (int j = 0; j < finished_lists; j++) {
-                                                std::cout << ")";
-                                            }
-                                        }
-                                    } else {
-                                        if (i != value.get_list_elements().size() - 1)
-                                            std::cout << ", ";
-                                    }
-                                } else {
-                                    if (i != value.get_list_elements().size() - 1)
-                                        std::cout << ", ";
-                                }
-                            }
-                        }
-                        std::cout << ")";
-                    } else if (value.get_type_of_node() == TypeOfObject::ENVIRONMENT || value.get_value_of_node() == "dummy") {
-                        std::cout << "dummy";
-                    } else if (value.get_type_of_node() == TypeOfObject::LAMBDA) {
-                        std::cout << "[lambda closure: ";
-                        std::cout << value.get_value_of_node() << ": ";
-                        std::cout << value.get_cs_index() << "]";
-                    } else {
-                        std::cout << value.get_value_of_node();
-                    }
-                }
-                    else if (identifier == "Isinteger")
-                    {
-                        CseNode nodeValue = stack.pop_last_node_return();
-                        if (nodeValue.get_type_of_node() == TypeOfObject::INTEGER)
-                        {
-                            stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
-                        }
-                        else
-                        {
-                            stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
-                        }
-                    }
-                    else if (identifier == "Isstring")
-                    {
-                        CseNode nodeValue = stack.pop_last_node_return();
-                        if (nodeValue.get_type_of_node() == TypeOfObject::STRING)
-                        {
-                            stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
-                        }
-                        else
-                        {
-                            stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
-                        }
-                    }
-                    else if (identifier == "Isempty")
-                    {
-                        CseNode nodeValue = stack.pop_last_node_return();
-                        if (nodeValue.get_type_of_node() == TypeOfObject::LIST)
-                        {
-                            if (nodeValue.get_list_elements().empty())
-                            {
-                                stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
-                            }
-                            else
-                            {
-                                stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
-                            }
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Invalid type for IsEmpty: " + nodeValue.get_value_of_node());
-                        }
-                    }
-                    else if (identifier == "Istuple")
-                    {
-                        CseNode nodeValue = stack.pop_last_node_return();
+    std::unique_ptr<TaskPool> pool; // workers of -parallel, nullptr when evaluation is sequential
+    std::vector<bool> cheap_structures; // by control structure, no function is applied when it runs
+    int speculationBudget = 0;          // branches evaluated ahead at the same time at most, 0 without -speculate
+    std::atomic<int> speculating{0};    // branches being evaluated ahead
 
-                        if (nodeValue.get_type_of_node() == TypeOfObject::LIST)
-                        {
-                            stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
-                        }
-                        else
-                        {
-                            stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
-                        }
-                    }
-                    else if (identifier == "Order")
+    // branches of a conditional evaluated ahead by other machines while the condition is evaluated in place
+    struct Speculation
+    {
+        std::size_t depth;                  // length of the control when the BETA node of the conditional is reached
+        int then_index;                     // control structure of the then branch, the else branch follows it
+        std::unique_ptr<CSE> machines[2];   // machines of the then and else branches, nullptr for a branch not started
+        std::exception_ptr errors[2];
+        std::atomic<int> pending{0};        // branches still running
+    };
+
+    std::vector<std::unique_ptr<Speculation>> speculations; // conditionals being evaluated, innermost last
+    std::atomic<bool> cancelled{false};                      // the machine evaluates a branch that was not taken
+
+    std::vector<ControlStructure> ControlStructs; // indexed by the index of the control structure
+    ControlStructure main_cs = ControlStructure(-1);
+    Stack stack = Stack();
+    std::vector<Environment *> environment_stack; // kept alive by the ENVIRONMENT markers of the calls on main_cs
+    std::vector<Environment::SavedBinding> saved_bindings; // bindings hidden by the BIND instructions in scope
+    EnvironmentRef global_environment;       // environment the program starts in
+    std::atomic<int> environment_count{0};   // labels of the heap environments, counted in root_machine
+    std::vector<std::vector<Symbol>> free_names; // by body control structure, the names its closures capture
+    std::unordered_set<const std::string *> bound_names; // names some lambda or BIND node binds, others are built in
+    bool fusion = true;                      // nodes are fused into superinstructions before evaluation
+
+    // superinstructions fused before evaluation, for -stats
+    struct FusionStats
+    {
+        std::size_t nodes_before = 0; // nodes of the control structures before fusion
+        std::size_t nodes_after = 0;
+        std::size_t calls = 0;
+        std::size_t builtins = 0;
+        std::size_t operations = 0;
+        std::size_t branches = 0;
+    };
+
+    FusionStats fusion_stats;
+
+    // operators with a form for integer operands, the comparisons last
+    enum class IntegerOperator : unsigned char
+    {
+        NONE,
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE,
+        NEGATE,
+        EQ,
+        NE,
+        LS,
+        LE,
+        GR,
+        GE
+    };
+
+    // forms an operator or gamma instruction takes, after its first run, for the values it met
+    enum class Quickening : unsigned char
+    {
+        UNSEEN,  // the instruction has not run yet
+        INTEGER, // an operator applied to integers
+        CLOSURE, // gamma applying the closures of one lambda
+        TUPLE,   // gamma indexing a tuple with an integer
+        GENERIC  // anything else, or the guard of the form taken failed
+    };
+
+    // the form of an instruction, shared by the copies of the instruction pushed on the control
+    struct QuickeningSite
+    {
+        IntegerOperator integer_operator = IntegerOperator::NONE; // decoded once, NONE for gamma instructions
+        std::atomic<Quickening> form{Quickening::UNSEEN};
+        std::atomic<int> body{-1}; // body of the closures a CLOSURE site applies
+        bool proven = false;        // -types proved the form, which is taken without checking the values
+    };
+
+    bool quickening = true;                      // instructions take a specialized form after their first run
+    std::deque<QuickeningSite> quickening_sites; // by site, kept by root_machine
+    long dispatches = 0; // nodes taken off the control, machines that evaluated parts of the program are added in
+    std::vector<int> curried_depths;         // by body control structure, lambdas a closure with the body takes in a row
+    std::deque<Environment> frame_stack;     // frames of the calls, reused in stack order
+    int frame_depth = 0;                     // number of frames of frame_stack in use
+    int frame_base = 0;                      // frames of the machines this one was started from, labels go on from them
+
+    // a call of a pure closure whose result is not known yet
+    struct MemoCall
+    {
+        MemoTable::Key key;
+        std::size_t depth;    // size of environment_stack while the call runs
+        long print_count;     // values printed before the call
+    };
+
+    std::optional<MemoTable> memo;       // results of calls with -memoize
+    std::vector<bool> pure_bodies;       // by body control structure, the call can be memoized
+    std::vector<MemoCall> memo_calls;    // calls whose results are kept when they return
+    long print_count = 0;                // values printed so far
+    OutputWriter task_output;            // output of a machine evaluating a parallel component, until it is merged
+    OutputWriter &output = OutputWriter::getInstance();
+
+    // machine evaluating a parallel component in the given environment of the parent machine
+    CSE(CSE *parent, Environment *environment)
+        : root_machine(parent->root_machine), parent_machine(parent), nesting(parent->nesting + 1),
+          frame_base(parent->frame_base + parent->frame_depth), output(task_output)
+    {
+        environment_stack.push_back(environment);
+    }
+
+public:
+    // constructor with empty control structures and stack
+    CSE() = default;
+
+    ~CSE()
+    {
+        // branches still evaluated ahead, when an error ended the evaluation, refer to this machine
+        for (auto &speculation : speculations)
+        {
+            for (auto &machine : speculation->machines)
+            {
+                if (machine)
+                {
+                    machine->cancelled = true;
+                }
+            }
+            root_machine->pool->wait(speculation->pending);
+        }
+    }
+
+    CSE(const CSE &) = delete;
+    CSE &operator=(const CSE &) = delete;
+
+    // lambda (in cs) node for a lambda tree node, its body goes to the given control structure
+    CseNode lambda_node(const StandardizedNode &root, int csIndex) const
+    {
+        StandardizedNode binder = root.getChild(0);
+
+        if (binder.getLabel() == ",")
+        {
+            std::vector<std::string> vars;
+            for (int i = 0; i < binder.getChildCount(); i++)
+            {
+                vars.push_back(binder.getChild(i).getValue());
+            }
+            return CseNode(TypeOfObject::LAMBDA, csIndex, vars);
+        }
+
+        return CseNode(TypeOfObject::LAMBDA, binder.getValue(), csIndex);
+    }
+
+    /**
+     * Adds the control structures of a lambda (one) or a conditional (two).
+     * The optimizer numbers lambda and conditional nodes before it removes any of them, the stored numbers are
+     * used so closures print the same index with and without optimization. Other nodes get the next free index.
+     * @return The index of the first control structure.
+     */
+    int add_control_structures(const StandardizedNode &node, int count)
+    {
+        std::string number = node.getValue();
+        int index = !number.empty() && std::isdigit(static_cast<unsigned char>(number[0])) ? std::stoi(number) : nextCS;
+
+        nextCS = std::max(nextCS, index + count);
+        while (static_cast<int>(ControlStructs.size()) < index + count)
+        {
+            ControlStructs.emplace_back(static_cast<int>(ControlStructs.size()));
+        }
+
+        return index;
+    }
+
+    // create control structures from the standardized tree
+    void create_cs(CustomTreeNode *root)
+    {
+        create_cs(StandardizedNode::of(root));
+    }
+
+    // create control structures straight from the abstract syntax tree, standardizing on the fly
+    void create_cs_fused(CustomTreeNode *root)
+    {
+        create_cs(StandardizedNode::standardize(root));
+    }
+
+    // create control structures, nodes waiting to be compiled are kept on an explicit stack
+    // so that deeply nested programs do not exhaust the C++ stack
+    // control structure being compiled, components of PARALLEL nodes have negative numbers until they are placed
+    ControlStructure &structure(int cs)
+    {
+        return cs >= 0 ? ControlStructs[cs] : components[-cs - 1];
+    }
+
+    // a tree node waiting to be compiled by create_cs
+    struct PendingNode
+    {
+        StandardizedNode node;
+        int cs;            // index of the control structure the node is compiled into
+        bool bind = false; // the node is the variable of a bind node, it is compiled into a BIND instruction
+    };
+
+    /**
+     * Adds the children of a tuple or an operator to the nodes waiting to be compiled. With -parallel, when two or
+     * more of them are not leaves, each goes to a control structure of its own and a PARALLEL node runs them.
+     */
+    void add_components(const StandardizedNode &node, int cs, std::vector<PendingNode> &children)
+    {
+        int count = node.getChildCount();
+        int inner = 0;
+        for (int i = 0; i < count; i++)
+        {
+            std::string label = node.getChild(i).getLabel();
+            if (label != "identifier" && label != "integer" && label != "string" && label != "true" &&
+                label != "false" && label != "tuple")
+            {
+                inner++;
+            }
+        }
+
+        if (!pool || inner < 2 || (node.getLabel() != "tau" && count != 2))
+        {
+            for (int i = 0; i < count; i++)
+            {
+                children.push_back({node.getChild(i), cs});
+            }
+            return;
+        }
+
+        int first = static_cast<int>(components.size());
+        CseNode parallel(TypeOfObject::PARALLEL, std::to_string(count), first);
+        structure(cs).append_node(parallel);
+
+        for (int i = 0; i < count; i++)
+        {
+            components.emplace_back(-(first + i + 1));
+            children.push_back({node.getChild(i), -(first + i + 1)});
+        }
+    }
+
+    /**
+     * Keeps the PARALLEL nodes worth running on threads: two or more of the components apply functions and none of
+     * them binds names in the current environment, which the components share. Keeps the SPECULATE nodes of
+     * conditionals whose condition and at least one branch apply functions, when neither the condition nor a branch
+     * binds names. The components and conditions of the other nodes are put back in place, giving the same control
+     * structure as a sequential build.
+     */
+    void keep_parallel_nodes()
+    {
+        cheap_structures = find_control_structures(
+            [](const CseNode &node)
+            { return node.get_type_of_node() != TypeOfObject::GAMMA && node.get_type_of_node() != TypeOfObject::GAMMA_N; },
+            false);
+        const std::vector<bool> &cheap = cheap_structures;
+        std::vector<bool> shareable = find_control_structures(
+            [](const CseNode &node)
+            {
+                return node.get_type_of_node() != TypeOfObject::BIND && node.get_type_of_node() != TypeOfObject::UNBIND;
+            },
+            false);
+
+        // components have larger indices than the control structures they are used in, so they are done first
+        for (int index = static_cast<int>(ControlStructs.size()) - 1; index >= 0; index--)
+        {
+            ControlStructure rebuilt(index);
+            bool changed = false;
+
+            for (const CseNode &node : ControlStructs[index].get_nodes())
+            {
+                if (node.get_type_of_node() == TypeOfObject::SPECULATE)
+                {
+                    int condition = componentOffset + node.get_cs_index();
+                    int then_index = std::stoi(node.get_value_of_node());
+
+                    if (!cheap[condition] && (!cheap[then_index] || !cheap[then_index + 1]) && shareable[condition] &&
+                        shareable[then_index] && shareable[then_index + 1])
                     {
-                        CseNode nodeValue = stack.pop_last_node_return();
-                        if (nodeValue.get_type_of_node() == TypeOfObject::LIST)
-                        {
-                            int count = 0;
-                            int listSkipElement = 0;
-
-                            for (const auto &i : nodeValue.get_list_elements())
-                            {
-                                if (i.get_type_of_node() == TypeOfObject::LIST && listSkipElement == 0)
-                                {
-                                    listSkipElement += std::stoi(i.get_value_of_node());
-                                    count++;
-                                }
-                                else if (listSkipElement == 0)
-                                {
-                                    count++;
-                                }
-                                else
-                                {
-                                    listSkipElement--;
-                                    continue;
-                                }
-                            }
-
-                            stack.append_node(CseNode(TypeOfObject::INTEGER, std::to_string(count)));
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Invalid type for Order: " + nodeValue.get_value_of_node());
-                        }
+                        rebuilt.append_node(node);
                     }
-                    else if (identifier == "Conc")
+                    else
                     {
-                        CseNode firstArg = stack.pop_last_node_return();
-                        CseNode secondArg = stack.pop_last_node_return();
-                        main_cs.pop_last_node();
-
-                        if (firstArg.get_type_of_node() == TypeOfObject::STRING &&
-                            (secondArg.get_type_of_node() == TypeOfObject::STRING ||
-                             secondArg.get_type_of_node() == TypeOfObject::INTEGER))
-                        {
-                            stack.append_node(
-                                CseNode(TypeOfObject::STRING, firstArg.get_value_of_node() + secondArg.get_value_of_node()));
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Invalid type for Conc: " + firstArg.get_value_of_node());
-                        }
+                        rebuilt.push_cs(ControlStructs[condition]);
+                        changed = true;
                     }
-                    else if (identifier == "Stem")
-                    {
-                        CseNode arg = stack.pop_last_node_return();
+                    continue;
+                }
+                if (node.get_type_of_node() != TypeOfObject::PARALLEL)
+                {
+                    rebuilt.append_node(node);
+                    continue;
+                }
 
-                        if (arg.get_type_of_node() == TypeOfObject::STRING)
-                        {
-                            stack.append_node(CseNode(TypeOfObject::STRING, arg.get_value_of_node().substr(0, 1)));
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Invalid type for Stem: " + top_of_stack.get_value_of_node());
-                        }
-                    }
-                    else if (identifier == "Stern")
-                    {
-                        CseNode arg = stack.pop_last_node_return();
+                int first = componentOffset + node.get_cs_index();
+                int count = std::stoi(node.get_value_of_node());
+                int expensive = 0;
+                bool shared = true;
+                for (int i = first; i < first + count; i++)
+                {
+                    expensive += cheap[i] ? 0 : 1;
+                    shared = shared && shareable[i];
+                }
 
-                        if (arg.get_type_of_node() == TypeOfObject::STRING)
-                        {
-                            stack.append_node(CseNode(TypeOfObject::STRING, arg.get_value_of_node().substr(1)));
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Invalid type for Stern: " + top_of_stack.get_value_of_node());
-                        }
+                if (expensive >= 2 && shared)
+                {
+                    rebuilt.append_node(node);
+                }
+                else
+                {
+                    for (int i = first; i < first + count; i++)
+                    {
+                        rebuilt.push_cs(ControlStructs[i]);
                     }
-                    else if (identifier == "Y*")
+                    changed = true;
+                }
+            }
+
+            if (changed)
+            {
+                ControlStructs[index] = std::move(rebuilt);
+            }
+        }
+    }
+
+    void create_cs(const StandardizedNode &root)
+    {
+        // control structures are stored by value, so they are referred to by index while the storage grows
+        ControlStructs.clear();
+        nextCS = 0;
+        ControlStructs.emplace_back(nextCS++);
+
+        components.clear();
+
+        std::vector<PendingNode> pendingNodes = {{root, 0}};
+        std::vector<PendingNode> children;
+
+        while (!pendingNodes.empty())
+        {
+            StandardizedNode node = pendingNodes.back().node;
+            int cs = pendingNodes.back().cs;
+            bool bind = pendingNodes.back().bind;
+            pendingNodes.pop_back();
+            children.clear();
+
+            if (bind)
+            {
+                structure(cs).emplace_node(TypeOfObject::BIND, node.getValue());
+            }
+            else if (node.getLabel() == "bind")
+            {
+                // bind X E B, a lambda the optimizer compiles into the frame it is applied in:
+                // E is evaluated, bound to X in the current environment, then B runs in the same control structure
+                structure(cs).emplace_node(TypeOfObject::UNBIND, node.getChild(0).getValue());
+
+                children.push_back({node.getChild(2), cs});
+                children.push_back({node.getChild(0), cs, true});
+                children.push_back({node.getChild(1), cs});
+            }
+            else if (node.getLabel() == "lambda")
+            {
+                int body_index = add_control_structures(node, 1);
+                structure(cs).append_node(lambda_node(node, body_index));
+
+                children.push_back({node.getChild(1), body_index});
+            }
+            else if (is_recursive_binding(node))
+            {
+                // gamma Y* (lambda f (lambda x E)) is compiled into one rec lambda node, the closure is
+                // created once over a frame that binds f to the closure itself
+                StandardizedNode rec_lambda = node.getChild(1);
+                StandardizedNode function = rec_lambda.getChild(1);
+                int body_index = add_control_structures(function, 1);
+                CseNode lambda = lambda_node(function, body_index);
+
+                structure(cs).append_node(lambda.set_recursive(rec_lambda.getChild(0).getValue()));
+
+                children.push_back({function.getChild(1), body_index});
+            }
+            else if (node.getLabel() == "tau")
+            {
+                structure(cs).emplace_node(TypeOfObject::TAU, std::to_string(node.getChildCount()));
+
+                add_components(node, cs, children);
+            }
+            else if (node.getLabel() == "->")
+            {
+                int then_index = add_control_structures(node, 2);
+                int else_index = then_index + 1;
+
+                structure(cs).emplace_node(TypeOfObject::DELTA, std::to_string(then_index));
+                structure(cs).emplace_node(TypeOfObject::DELTA, std::to_string(else_index));
+                structure(cs).emplace_node(TypeOfObject::BETA, "");
+
+                children.push_back({node.getChild(1), then_index});
+                children.push_back({node.getChild(2), else_index});
+
+                if (speculationBudget > 0)
+                {
+                    // the condition goes to a control structure of its own, a SPECULATE node runs it
+                    int condition = static_cast<int>(components.size());
+                    components.emplace_back(-(condition + 1));
+                    structure(cs).append_node(CseNode(TypeOfObject::SPECULATE, std::to_string(then_index), condition));
+                    children.push_back({node.getChild(0), -(condition + 1)});
+                }
+                else
+                {
+                    children.push_back({node.getChild(0), cs});
+                }
+            }
+            else if (is_operator(node.getLabel()))
+            {
+                // -types marks the operators whose operands are proven to be integers
+                CseNode instruction(TypeOfObject::OPERATOR, node.getLabel());
+                instruction.set_proven(node.getValue() == "typed");
+                structure(cs).append_node(std::move(instruction));
+
+                add_components(node, cs, children);
+            }
+            else if (node.getLabel() == "gamma")
+            {
+                // f a1 ... an is gamma (... (gamma f a1) ...) an, the whole chain is compiled into one GAMMA_N node
+                std::vector<StandardizedNode> arguments = {node.getChild(1)};
+                StandardizedNode function = node.getChild(0);
+                while (function.getLabel() == "gamma" && !is_recursive_binding(function))
+                {
+                    arguments.push_back(function.getChild(1));
+                    function = function.getChild(0);
+                }
+
+                if (arguments.size() == 1)
+                {
+                    // -types marks the gammas proven to index a tuple with an integer
+                    CseNode instruction(TypeOfObject::GAMMA, "");
+                    instruction.set_proven(node.getValue() == "typed");
+                    structure(cs).append_node(std::move(instruction));
+                }
+                else
+                {
+                    structure(cs).append_node(CseNode(TypeOfObject::GAMMA_N, "", static_cast<int>(arguments.size())));
+                }
+
+                children.push_back({function, cs});
+                for (auto it = arguments.rbegin(); it != arguments.rend(); ++it)
+                {
+                    children.push_back({*it, cs});
+                }
+            }
+            else if (node.getLabel() == "identifier")
+            {
+                structure(cs).emplace_node(TypeOfObject::IDENTIFIER, node.getValue());
+            }
+            else if (node.getLabel() == "integer")
+            {
+                structure(cs).emplace_node(TypeOfObject::INTEGER, node.getValue());
+            }
+            else if (node.getLabel() == "string")
+            {
+                structure(cs).emplace_node(TypeOfObject::STRING, node.getValue());
+            }
+            else if (node.getLabel() == "true" || node.getLabel() == "false")
+            {
+                structure(cs).emplace_node(TypeOfObject::BOOLEAN, node.getLabel());
+            }
+            else if (node.getLabel() == "tuple")
+            {
+                structure(cs).append_node(constant_tuple(node));
+            }
+            else
+            {
+                throw std::runtime_error("Invalid node type: " + node.getLabel() + "Value: " + node.getValue());
+            }
+
+            // children are compiled in order, so they are pushed in reverse
+            pendingNodes.insert(pendingNodes.end(), children.rbegin(), children.rend());
+        }
+
+        componentOffset = static_cast<int>(ControlStructs.size());
+        for (const ControlStructure &component : components)
+        {
+            ControlStructs.emplace_back(static_cast<int>(ControlStructs.size()));
+            ControlStructs.back().push_cs(component);
+        }
+        components.clear();
+
+        if (pool)
+        {
+            keep_parallel_nodes();
+        }
+    }
+
+    // value of an integer, string, true or false leaf
+    static CseNode constant_value(const StandardizedNode &leaf)
+    {
+        if (leaf.getLabel() == "integer")
+        {
+            return CseNode(TypeOfObject::INTEGER, leaf.getValue());
+        }
+        if (leaf.getLabel() == "string")
+        {
+            return CseNode(TypeOfObject::STRING, leaf.getValue());
+        }
+        if (leaf.getLabel() == "true" || leaf.getLabel() == "false")
+        {
+            return CseNode(TypeOfObject::BOOLEAN, leaf.getLabel());
+        }
+
+        throw std::runtime_error("Not a constant: " + leaf.getLabel());
+    }
+
+    // value of a tuple node of constants, built the same way tau builds tuples at run time
+    static CseNode constant_tuple(const StandardizedNode &tuple)
+    {
+        struct PendingTuple
+        {
+            StandardizedNode node;
+            int nextChild;
+            std::vector<CseNode> elements;
+        };
+
+        std::vector<PendingTuple> pendingTuples = {{tuple, 0, {}}};
+
+        while (true)
+        {
+            PendingTuple &current = pendingTuples.back();
+
+            if (current.nextChild == current.node.getChildCount())
+            {
+                CseNode value(TypeOfObject::LIST, std::move(current.elements));
+                pendingTuples.pop_back();
+
+                if (pendingTuples.empty())
+                {
+                    return value;
+                }
+                pendingTuples.back().elements.push_back(std::move(value));
+                continue;
+            }
+
+            StandardizedNode child = current.node.getChild(current.nextChild++);
+
+            if (child.getLabel() == "tuple")
+            {
+                pendingTuples.push_back({child, 0, {}});
+            }
+            else
+            {
+                current.elements.push_back(constant_value(child));
+            }
+        }
+    }
+
+    // whether two values are equal for eq and ne, strings and integers are compared without formatting them
+    static bool same_value(const CseNode &first, const CseNode &second)
+    {
+        if (first.get_type_of_node() == TypeOfObject::STRING && second.get_type_of_node() == TypeOfObject::STRING)
+        {
+            return first.get_string_value() == second.get_string_value();
+        }
+        if (first.get_type_of_node() == TypeOfObject::INTEGER && second.get_type_of_node() == TypeOfObject::INTEGER)
+        {
+            return first.get_integer_value() == second.get_integer_value();
+        }
+
+        return first.get_value_of_node() == second.get_value_of_node();
+    }
+
+    // write the text of a value that is not a tuple
+    void print_element(const CseNode &value)
+    {
+        if (value.get_type_of_node() == TypeOfObject::STRING)
+        {
+            RpalString text = value.get_string_value();
+            output.write(text.view());
+        }
+        else
+        {
+            output.write(value.get_value_of_node());
+        }
+    }
+
+    // write a value for Print, nested tuples are written with an explicit stack of the tuples still open
+    void print_value(const CseNode &value)
+    {
+        if (value.get_type_of_node() == TypeOfObject::LIST)
+        {
+            struct OpenTuple
+            {
+                Span<CseNode> elements;
+                size_t next;
+            };
+
+            std::vector<OpenTuple> open_tuples;
+            const CseNode *element = &value;
+
+            while (true)
+            {
+                if (element->get_type_of_node() == TypeOfObject::LIST)
+                {
+                    Span<CseNode> elements = element->get_list_elements();
+                    if (!elements.empty())
                     {
-                        CseNode lambda = stack.pop_last_node_return();
+                        output.write('(');
+                        open_tuples.push_back({elements, 1});
+                        element = &elements[0];
+                        continue;
+                    }
+
+                    output.write("nil");
+                }
+                else
+                {
+                    print_element(*element);
+                }
+
+                while (!open_tuples.empty() && open_tuples.back().next == open_tuples.back().elements.size())
+                {
+                    open_tuples.pop_back();
+                    output.write(')');
+                }
+
+                if (open_tuples.empty())
+                {
+                    return;
+                }
+
+                output.write(", ");
+                element = &open_tuples.back().elements[open_tuples.back().next++];
+            }
+        }
+        else if (value.get_value_of_node() == "dummy")
+        {
+            output.write("dummy");
+        }
+        else if (value.get_type_of_node() == TypeOfObject::LAMBDA)
+        {
+            output.write("[lambda closure: " + value.get_value_of_node() + ": " + std::to_string(value.get_cs_index()) + "]");
+        }
+        else
+        {
+            print_element(value);
+        }
+    }
+
+    // bind the argument of a lambda with one bound variable
+    static void bind_value(Environment *environment, Symbol identifier, const CseNode &value)
+    {
+        if (value.get_type_of_node() == TypeOfObject::LAMBDA || value.get_type_of_node() == TypeOfObject::EETA)
+        {
+            environment->append_lambda(identifier, value);
+        }
+        else if (value.get_type_of_node() == TypeOfObject::STRING || value.get_type_of_node() == TypeOfObject::INTEGER)
+        {
+            environment->append_variable(identifier, value);
+        }
+        else if (value.get_type_of_node() == TypeOfObject::LIST)
+        {
+            environment->append_list(identifier, value);
+        }
+        else
+        {
+            throw std::runtime_error("Invalid object for gamma: " + value.get_value_of_node());
+        }
+    }
+
+    /**
+     * Applies an operator of the CSE machine to its operands.
+     * @param operator_ The operator.
+     * @param first The left operand, or the only operand of neg and not.
+     * @param second The right operand, not used by neg and not.
+     * @return The value of the operation.
+     * @throws std::runtime_error if the operator is not defined for the operands.
+     */
+    static CseNode apply_operator(const std::string &operator_, const CseNode &first, const CseNode &second)
+    {
+        if (operator_ == "+")
+        {
+            return CseNode(first.get_integer_value() + second.get_integer_value());
+        }
+        else if (operator_ == "-")
+        {
+            return CseNode(first.get_integer_value() - second.get_integer_value());
+        }
+        else if (operator_ == "/")
+        {
+            return CseNode(first.get_integer_value() / second.get_integer_value());
+        }
+        else if (operator_ == "*")
+        {
+            return CseNode(first.get_integer_value() * second.get_integer_value());
+        }
+        else if (operator_ == "**")
+        {
+            return CseNode(first.get_integer_value().pow(second.get_integer_value()));
+        }
+        else if (operator_ == "neg")
+        {
+            return CseNode(-first.get_integer_value());
+        }
+        else if (operator_ == "not")
+        {
+            if (first.get_value_of_node() == "true")
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "false");
+            }
+            else
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "true");
+            }
+        }
+        else if (operator_ == "eq")
+        {
+            if (same_value(first, second))
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "true");
+            }
+            else
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "false");
+            }
+        }
+        else if (operator_ == "gr")
+        {
+            if (first.get_integer_value() > second.get_integer_value())
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "true");
+            }
+            else
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "false");
+            }
+        }
+        else if (operator_ == "ge")
+        {
+            if (first.get_integer_value() >= second.get_integer_value())
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "true");
+            }
+            else
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "false");
+            }
+        }
+        else if (operator_ == "ls")
+        {
+            if (first.get_integer_value() < second.get_integer_value())
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "true");
+            }
+            else
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "false");
+            }
+        }
+        else if (operator_ == "le")
+        {
+            if (first.get_integer_value() <= second.get_integer_value())
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "true");
+            }
+            else
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "false");
+            }
+        }
+        else if (operator_ == "ne")
+        {
+            if (!same_value(first, second))
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "true");
+            }
+            else
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "false");
+            }
+        }
+        else if (operator_ == "aug")
+        {
+            if (first.get_type_of_node() == TypeOfObject::LIST)
+            {
+                if (second.get_type_of_node() == TypeOfObject::LIST)
+                {
+                    return first.appended(second);
+                }
+                else if (second.get_type_of_node() == TypeOfObject::INTEGER ||
+                         second.get_type_of_node() == TypeOfObject::BOOLEAN ||
+                         second.get_type_of_node() == TypeOfObject::STRING)
+                {
+                    return first.appended(second.value_copy());
+                }
+                else
+                {
+                    throw std::runtime_error("Invalid type for aug: " + second.get_value_of_node());
+                }
+            }
+            else
+            {
+                throw std::runtime_error("Invalid type for aug: " + first.get_value_of_node());
+            }
+        }
+        else if (operator_ == "or")
+        {
+            if (first.get_value_of_node() == "true" || second.get_value_of_node() == "true")
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "true");
+            }
+            else
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "false");
+            }
+        }
+        else if (operator_ == "&")
+        {
+            if (first.get_value_of_node() == "true" && second.get_value_of_node() == "true")
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "true");
+            }
+            else
+            {
+                return CseNode(TypeOfObject::BOOLEAN, "false");
+            }
+        }
+        else
+        {
+            throw std::runtime_error("Invalid operator: " + operator_);
+        }
+    }
+
+    /**
+     * Closure conversion. A closure does not keep the environment it is created in, it copies the bindings of its
+     * free names: the names its body and the lambdas in it look up, other than its own parameters. A rec closure
+     * keeps its own name among them, since its environment is where it binds itself. For each kind of binding the
+     * first one visible is copied, so the variables, lambdas and lists found are the ones found before through the
+     * chain of environments. Names that no lambda or BIND node binds, such as the builtin functions, are left out,
+     * and a closure with no free names gets no environment at all. Since no closure refers to the frame of a call,
+     * frames are released in stack order.
+     */
+    void find_free_names()
+    {
+        bound_names.clear();
+        std::vector<std::unordered_set<const std::string *>> own(ControlStructs.size()); // by body, its parameters
+        for (const ControlStructure &cs : ControlStructs)
+        {
+            for (const CseNode &node : cs.get_nodes())
+            {
+                TypeOfObject type = node.get_type_of_node();
+                if (type == TypeOfObject::LAMBDA || type == TypeOfObject::REC_LAMBDA)
+                {
+                    std::unordered_set<const std::string *> &parameters = own[node.get_cs_index()];
+                    if (node.get_is_one_bound_var())
+                    {
+                        parameters.insert(&node.get_symbol().get_name());
+                    }
+                    for (Symbol variable : node.get_bound_variables_list())
+                    {
+                        parameters.insert(&variable.get_name());
+                    }
+                    bound_names.insert(parameters.begin(), parameters.end());
+                    if (type == TypeOfObject::REC_LAMBDA)
+                    {
+                        bound_names.insert(&node.get_recursive_variable().get_name());
+                    }
+                }
+                else if (type == TypeOfObject::BIND)
+                {
+                    bound_names.insert(&node.get_symbol().get_name());
+                }
+            }
+        }
+
+        // names looked up by each control structure and the ones it runs, in the order they are found
+        std::vector<std::unordered_set<const std::string *>> names(ControlStructs.size());
+        std::vector<std::vector<Symbol>> ordered(ControlStructs.size());
+
+        // a control structure takes the names of every control structure it runs, so repeat until nothing changes.
+        // Nested control structures have larger indices, so going backwards one pass is usually enough
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+
+            for (int index = static_cast<int>(ControlStructs.size()) - 1; index >= 0; index--)
+            {
+                auto add = [&](Symbol name)
+                {
+                    if (bound_names.count(&name.get_name()) != 0 && names[index].insert(&name.get_name()).second)
+                    {
+                        ordered[index].push_back(name);
+                        changed = true;
+                    }
+                };
+                auto add_all = [&](int nested, bool lambda_body)
+                {
+                    for (std::size_t i = 0; i < ordered[nested].size(); i++)
+                    {
+                        if (!lambda_body || own[nested].count(&ordered[nested][i].get_name()) == 0)
+                        {
+                            add(ordered[nested][i]);
+                        }
+                    }
+                };
+
+                for (const CseNode &node : ControlStructs[index].get_nodes())
+                {
+                    TypeOfObject type = node.get_type_of_node();
+                    if (type == TypeOfObject::IDENTIFIER)
+                    {
+                        add(node.get_symbol());
+                    }
+                    else if (type == TypeOfObject::LAMBDA || type == TypeOfObject::REC_LAMBDA)
+                    {
+                        add_all(node.get_cs_index(), true);
+                    }
+                    else if (type == TypeOfObject::DELTA)
+                    {
+                        add_all(std::stoi(node.get_value_of_node()), false);
+                    }
+                    else if (type == TypeOfObject::PARALLEL)
+                    {
+                        int first = componentOffset + node.get_cs_index();
+                        for (int i = first; i < first + std::stoi(node.get_value_of_node()); i++)
+                        {
+                            add_all(i, false);
+                        }
+                    }
+                    else if (type == TypeOfObject::SPECULATE)
+                    {
+                        add_all(componentOffset + node.get_cs_index(), false);
+                    }
+                }
+            }
+        }
+
+        free_names.assign(ControlStructs.size(), {});
+        for (std::size_t body = 0; body < ControlStructs.size(); body++)
+        {
+            for (Symbol name : ordered[body])
+            {
+                if (own[body].count(&name.get_name()) == 0)
+                {
+                    free_names[body].push_back(name);
+                }
+            }
+        }
+    }
+
+    /**
+     * Environment of a closure with the given body created in the current environment, holding the bindings of
+     * the free names of the body. nullptr when the body has no free names.
+     */
+    EnvironmentRef capture(int body)
+    {
+        const std::vector<Symbol> &names = root_machine->free_names[body];
+        if (names.empty())
+        {
+            return EnvironmentRef();
+        }
+
+        EnvironmentRef captured = new_environment(EnvironmentRef());
+        const Environment *environment = environment_stack.back();
+        for (Symbol name : names)
+        {
+            captured->capture(name, *environment);
+        }
+        return captured;
+    }
+
+    /**
+     * Finds the curried functions. A lambda whose body is nothing but another lambda is one level of a curried
+     * function, so the depth of a body is one more than the depth of the body of that lambda. GAMMA_N applies a
+     * closure to as many arguments as the depth of its body in one frame, without creating the closures in between.
+     */
+    void find_curried_bodies()
+    {
+        curried_depths.assign(ControlStructs.size(), 1);
+
+        // nested control structures have larger indices
+        for (int index = static_cast<int>(ControlStructs.size()) - 1; index >= 0; index--)
+        {
+            const std::vector<CseNode> &nodes = ControlStructs[index].get_nodes();
+            if (nodes.size() == 1 && nodes[0].get_type_of_node() == TypeOfObject::LAMBDA &&
+                nodes[0].get_cs_index() > index)
+            {
+                curried_depths[index] = curried_depths[nodes[0].get_cs_index()] + 1;
+            }
+        }
+    }
+
+    /**
+     * Purity check for -memoize. RPAL values cannot change, so the only effect a call can have is printing.
+     * A body passes when Print is not named in it, in the branches of its conditionals or in the lambdas it creates.
+     * Print can still be reached through a function passed in, so results of calls that printed are not kept.
+     */
+    void find_pure_bodies()
+    {
+        pure_bodies = find_control_structures(
+            [](const CseNode &node)
+            {
+                return node.get_type_of_node() != TypeOfObject::IDENTIFIER ||
+                       (node.get_value_of_node() != "Print" && node.get_value_of_node() != "print");
+            },
+            true);
+    }
+
+    // whether a node is a constant or an identifier, the operand of a superinstruction
+    static bool is_leaf(const CseNode &node)
+    {
+        TypeOfObject type = node.get_type_of_node();
+        return type == TypeOfObject::IDENTIFIER || type == TypeOfObject::INTEGER || type == TypeOfObject::STRING ||
+               type == TypeOfObject::BOOLEAN || type == TypeOfObject::LIST;
+    }
+
+    // number of operands an operator takes
+    static int operator_arity(const std::string &operator_)
+    {
+        return operator_ == "neg" || operator_ == "not" ? 1 : 2;
+    }
+
+    // whether an identifier names a built-in function wherever it is, since no lambda or BIND node binds the name.
+    // Conc is left out, it takes its second argument by removing the gamma node that follows it from the control
+    bool is_builtin(const CseNode &node) const
+    {
+        if (node.get_type_of_node() != TypeOfObject::IDENTIFIER || node.get_value_of_node() == "Conc" ||
+            bound_names.count(&node.get_symbol().get_name()) != 0)
+        {
+            return false;
+        }
+        return std::find(builtInFunctions.begin(), builtInFunctions.end(), node.get_value_of_node()) !=
+               builtInFunctions.end();
+    }
+
+    /**
+     * Peephole pass fusing short sequences of nodes into superinstructions, so that each takes one dispatch of the
+     * evaluation loop. Nodes are stored in prefix order, so the operands of an operator or a gamma node that are
+     * leaves are the nodes right after it:
+     * - gamma applied to an identifier and a leaf becomes CALL, and BUILTIN when the identifier names a built-in
+     *   function, which is then applied without looking the name up
+     * - an operator applied to leaves becomes OPERATION
+     * - delta delta beta becomes BRANCH, together with the operator computing the condition and its leaves. A
+     *   conditional evaluated speculatively is left alone, the BETA node finds its speculation by its place
+     * Runs after the other passes over the control structures, which only know the nodes built by create_cs.
+     */
+    void fuse_control_structures()
+    {
+        for (ControlStructure &cs : ControlStructs)
+        {
+            const std::vector<CseNode> &nodes = cs.get_nodes();
+            ControlStructure fused(cs.get_cs_index());
+
+            // whether the given number of nodes from first on are leaves
+            auto leaves = [&](std::size_t first, int count)
+            {
+                for (std::size_t i = first; i < first + count; i++)
+                {
+                    if (i >= nodes.size() || !is_leaf(nodes[i]))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            auto operands = [&](std::size_t first, int count)
+            { return std::vector<CseNode>(nodes.begin() + first, nodes.begin() + first + count); };
+
+            std::size_t i = 0;
+            while (i < nodes.size())
+            {
+                const CseNode &node = nodes[i];
+                TypeOfObject type = node.get_type_of_node();
+
+                if (type == TypeOfObject::DELTA && i + 2 < nodes.size() &&
+                    nodes[i + 1].get_type_of_node() == TypeOfObject::DELTA &&
+                    nodes[i + 2].get_type_of_node() == TypeOfObject::BETA &&
+                    (i + 3 == nodes.size() || nodes[i + 3].get_type_of_node() != TypeOfObject::SPECULATE))
+                {
+                    int then_index = std::stoi(node.get_value_of_node());
+                    std::size_t next = i + 3;
+                    std::string operator_;
+                    int arity = 0;
+
+                    if (next < nodes.size() && nodes[next].get_type_of_node() == TypeOfObject::OPERATOR)
+                    {
+                        operator_ = nodes[next].get_value_of_node();
+                        next++;
+                        arity = leaves(next, operator_arity(operator_)) ? operator_arity(operator_) : 0;
+                    }
+
+                    CseNode branch(TypeOfObject::BRANCH, operator_, then_index, operands(next, arity));
+                    branch.set_proven(!operator_.empty() && nodes[i + 3].is_proven());
+                    fused.append_node(std::move(branch));
+                    fusion_stats.branches++;
+                    i = next + arity;
+                }
+                else if (type == TypeOfObject::OPERATOR && leaves(i + 1, operator_arity(node.get_value_of_node())))
+                {
+                    int arity = operator_arity(node.get_value_of_node());
+
+                    CseNode operation(TypeOfObject::OPERATION, node.get_value_of_node(), 0, operands(i + 1, arity));
+                    operation.set_proven(node.is_proven());
+                    fused.append_node(std::move(operation));
+                    fusion_stats.operations++;
+                    i += 1 + arity;
+                }
+                else if (type == TypeOfObject::GAMMA && leaves(i + 1, 1))
+                {
+                    int arity = leaves(i + 2, 1) ? 1 : 0;
+
+                    if (is_builtin(nodes[i + 1]))
+                    {
+                        fused.append_node(CseNode(TypeOfObject::BUILTIN, nodes[i + 1].get_value_of_node(), 0,
+                                                  operands(i + 2, arity)));
+                        fusion_stats.builtins++;
+                    }
+                    else
+                    {
+                        CseNode call(TypeOfObject::CALL, "", 0, operands(i + 1, 1 + arity));
+                        call.set_proven(node.is_proven());
+                        fused.append_node(std::move(call));
+                        fusion_stats.calls++;
+                    }
+                    i += 2 + arity;
+                }
+                else
+                {
+                    fused.append_node(node);
+                    i++;
+                }
+            }
+
+            fusion_stats.nodes_before += nodes.size();
+            fusion_stats.nodes_after += fused.get_nodes().size();
+            cs = std::move(fused);
+        }
+    }
+
+    // the integer form of an operator, NONE when it has none
+    static IntegerOperator integer_operator(const std::string &operator_)
+    {
+        static const std::pair<const char *, IntegerOperator> operators[] = {
+            {"+", IntegerOperator::ADD}, {"-", IntegerOperator::SUBTRACT}, {"*", IntegerOperator::MULTIPLY},
+            {"/", IntegerOperator::DIVIDE}, {"neg", IntegerOperator::NEGATE}, {"eq", IntegerOperator::EQ},
+            {"ne", IntegerOperator::NE}, {"ls", IntegerOperator::LS}, {"le", IntegerOperator::LE},
+            {"gr", IntegerOperator::GR}, {"ge", IntegerOperator::GE}};
+
+        for (const auto &entry : operators)
+        {
+            if (operator_ == entry.first)
+            {
+                return entry.second;
+            }
+        }
+        return IntegerOperator::NONE;
+    }
+
+    /**
+     * Gives every operator and gamma instruction a quickening site. The first run of an instruction quickens it:
+     * depending on the values it meets, its site takes a form with a cheap guard, which later runs check before
+     * they go straight to the specialized code, or the generic form. A guard that fails turns the site generic for
+     * good, so an instruction switches forms at most twice. Operators without an integer form start generic, and
+     * instructions whose operands type inference proved start in their integer or tuple form, without a guard.
+     * Runs after fusion, so superinstructions get sites too.
+     */
+    void add_quickening_sites()
+    {
+        quickening_sites.clear();
+
+        for (ControlStructure &cs : ControlStructs)
+        {
+            ControlStructure quickened(cs.get_cs_index());
+
+            for (const CseNode &node : cs.get_nodes())
+            {
+                CseNode instruction = node;
+                TypeOfObject type = node.get_type_of_node();
+                bool applies_operator = type == TypeOfObject::OPERATOR || type == TypeOfObject::OPERATION ||
+                                        (type == TypeOfObject::BRANCH && !node.get_value_of_node().empty());
+
+                if (applies_operator || type == TypeOfObject::GAMMA || type == TypeOfObject::CALL)
+                {
+                    instruction.set_site(static_cast<int>(quickening_sites.size()));
+                    QuickeningSite &site = quickening_sites.emplace_back();
+
+                    if (applies_operator)
+                    {
+                        site.integer_operator = integer_operator(node.get_value_of_node());
+                        if (site.integer_operator == IntegerOperator::NONE)
+                        {
+                            site.form = Quickening::GENERIC;
+                        }
+                    }
+
+                    if (node.is_proven() && (!applies_operator || site.integer_operator != IntegerOperator::NONE))
+                    {
+                        site.proven = true;
+                        site.form = applies_operator ? Quickening::INTEGER : Quickening::TUPLE;
+                    }
+                }
+                quickened.append_node(std::move(instruction));
+            }
+
+            cs = std::move(quickened);
+        }
+    }
+
+    // quickening site of an instruction, nullptr when it has none
+    QuickeningSite *quickening_site(const CseNode &instruction) const
+    {
+        return instruction.get_site() < 0 ? nullptr : &root_machine->quickening_sites[instruction.get_site()];
+    }
+
+    // whether an operator site takes its integer form for the operands, the first run quickens the site
+    static bool takes_integers(QuickeningSite &site, const CseNode &first, const CseNode &second)
+    {
+        if (site.proven)
+        {
+            return true;
+        }
+
+        Quickening form = site.form.load(std::memory_order_relaxed);
+        if (form == Quickening::GENERIC)
+        {
+            return false;
+        }
+
+        bool integers = first.get_type_of_node() == TypeOfObject::INTEGER &&
+                        (site.integer_operator == IntegerOperator::NEGATE ||
+                         second.get_type_of_node() == TypeOfObject::INTEGER);
+        if (form == Quickening::UNSEEN || !integers)
+        {
+            site.form.store(integers ? Quickening::INTEGER : Quickening::GENERIC, std::memory_order_relaxed);
+        }
+        return integers;
+    }
+
+    /**
+     * The form a gamma site takes for the function it applies and the argument on top of the stack, the first run
+     * quickens the site. A CLOSURE site keeps to the closures of one lambda. Calls with -memoize stay generic,
+     * they look for a kept result first.
+     */
+    Quickening quicken_call(QuickeningSite &site, const CseNode &function) const
+    {
+        if (site.proven)
+        {
+            return Quickening::TUPLE;
+        }
+
+        Quickening form = site.form.load(std::memory_order_relaxed);
+        if (form == Quickening::GENERIC)
+        {
+            return form;
+        }
+
+        Quickening met = Quickening::GENERIC;
+        if (function.get_type_of_node() == TypeOfObject::LAMBDA && !memo)
+        {
+            met = Quickening::CLOSURE;
+        }
+        else if (function.get_type_of_node() == TypeOfObject::LIST && stack.length() > 0 &&
+                 stack.get_last_node().get_type_of_node() == TypeOfObject::INTEGER)
+        {
+            met = Quickening::TUPLE;
+        }
+
+        if (form == Quickening::UNSEEN)
+        {
+            site.body.store(function.get_cs_index(), std::memory_order_relaxed);
+            site.form.store(met, std::memory_order_relaxed);
+            return met;
+        }
+        if (met == form && (form != Quickening::CLOSURE ||
+                            function.get_cs_index() == site.body.load(std::memory_order_relaxed)))
+        {
+            return form;
+        }
+
+        site.form.store(Quickening::GENERIC, std::memory_order_relaxed);
+        return Quickening::GENERIC;
+    }
+
+    /**
+     * Marks the control structures whose nodes pass a check, along with the nodes of every control structure they
+     * run: the branches and conditions of their conditionals, the components of their PARALLEL nodes and, when
+     * follow_lambdas is set, the bodies of the lambdas they create.
+     */
+    template <typename Check>
+    std::vector<bool> find_control_structures(Check passes, bool follow_lambdas) const
+    {
+        std::vector<bool> marked(ControlStructs.size(), true);
+
+        // a control structure loses the mark when one it runs loses it, so repeat until nothing changes.
+        // Nested control structures have larger indices, so going backwards one pass is usually enough
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+
+            for (auto it = ControlStructs.rbegin(); it != ControlStructs.rend(); ++it)
+            {
+                const ControlStructure &cs = *it;
+                int index = cs.get_cs_index();
+                if (!marked[index])
+                {
+                    continue;
+                }
+
+                for (const CseNode &node : cs.get_nodes())
+                {
+                    TypeOfObject type = node.get_type_of_node();
+                    bool creates_lambda = type == TypeOfObject::LAMBDA || type == TypeOfObject::REC_LAMBDA;
+
+                    bool components_marked = true;
+                    if (type == TypeOfObject::PARALLEL)
+                    {
+                        int first = componentOffset + node.get_cs_index();
+                        for (int i = first; i < first + std::stoi(node.get_value_of_node()); i++)
+                        {
+                            components_marked = components_marked && marked[i];
+                        }
+                    }
+                    else if (type == TypeOfObject::SPECULATE)
+                    {
+                        components_marked = marked[componentOffset + node.get_cs_index()];
+                    }
+
+                    if (!passes(node) || !components_marked ||
+                        (type == TypeOfObject::DELTA && !marked[std::stoi(node.get_value_of_node())]) ||
+                        (follow_lambdas && creates_lambda && !marked[node.get_cs_index()]))
+                    {
+                        marked[index] = false;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        return marked;
+    }
+
+    /**
+     * Looks up the result of a call of a pure closure with -memoize, the argument is on top of the stack.
+     * A result that is found replaces the argument. Otherwise the call is recorded, so its result is kept
+     * when its environment is exited.
+     * @return Whether the result was found.
+     */
+    bool recall_call(const CseNode &closure)
+    {
+        if (!pure_bodies[closure.get_cs_index()] || !MemoTable::is_key(stack.get_last_node()))
+        {
+            return false;
+        }
+
+        MemoTable::Key key{closure.get_cs_index(), closure.get_environment(), stack.get_last_node()};
+        const CseNode *result = memo->find(key);
+
+        if (result != nullptr)
+        {
+            stack.pop_last_node();
+            stack.append_node(*result);
+            return true;
+        }
+
+        memo_calls.push_back({std::move(key), environment_stack.size() + 1, print_count});
+        return false;
+    }
+
+    // keep the result of a recorded call when the environment of the call is exited and the call did not print
+    void remember_call(const CseNode &result)
+    {
+        if (memo_calls.empty() || memo_calls.back().depth != environment_stack.size())
+        {
+            return;
+        }
+
+        if (memo_calls.back().print_count == print_count)
+        {
+            memo->insert(std::move(memo_calls.back().key), result);
+        }
+        memo_calls.pop_back();
+    }
+
+    /**
+     * Evaluates the components of a PARALLEL node. The components are evaluated on the workers of the pool by
+     * machines of their own, in the current environment. Their values and output are then taken over
+     * in the order of sequential evaluation, from the last component to the first, and the first error is thrown.
+     * When the pool has more waiting tasks than workers, the components are evaluated in place instead.
+     */
+    void evaluate_parallel(const CseNode &parallel)
+    {
+        int first = root_machine->componentOffset + parallel.get_cs_index();
+        int count = std::stoi(parallel.get_value_of_node());
+        TaskPool &tasks = *root_machine->pool;
+
+        if (nesting >= MAX_PARALLEL_NESTING || tasks.saturated())
+        {
+            for (int i = first; i < first + count; i++)
+            {
+                main_cs.push_cs(root_machine->ControlStructs[i]);
+            }
+            return;
+        }
+
+        std::vector<std::unique_ptr<CSE>> machines;
+        std::vector<std::exception_ptr> errors(count);
+        std::atomic<int> pending{count - 1};
+
+        for (int i = 0; i < count; i++)
+        {
+            machines.push_back(std::unique_ptr<CSE>(new CSE(this, environment_stack.back())));
+        }
+
+        // the first component is evaluated by this thread while the workers take the others
+        for (int i = count - 1; i >= 1; i--)
+        {
+            tasks.submit([&, i]()
+                         {
+                             try
+                             {
+                                 machines[i]->run(first + i);
+                             }
+                             catch (...)
+                             {
+                                 errors[i] = std::current_exception();
+                             }
+                             pending--;
+                         });
+        }
+
+        try
+        {
+            machines[0]->run(first);
+        }
+        catch (...)
+        {
+            errors[0] = std::current_exception();
+        }
+
+        tasks.wait(pending);
+
+        for (int i = count - 1; i >= 0; i--)
+        {
+            take_over(*machines[i], errors[i]);
+        }
+    }
+
+    // take over the output and values of a machine that evaluated a control structure for this one
+    void take_over(CSE &machine, const std::exception_ptr &error)
+    {
+        output.write(machine.task_output.take());
+        print_count += machine.print_count;
+        dispatches += machine.dispatches;
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+
+        stack.take_all(machine.stack);
+    }
+
+    // whether this machine or one it was started from evaluates a branch that was not taken
+    bool is_cancelled() const
+    {
+        for (const CSE *machine = this; machine != nullptr; machine = machine->parent_machine)
+        {
+            if (machine->cancelled)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Evaluates a SPECULATE node. The branches of the conditional that apply functions are started on the pool by
+     * machines of their own, as long as the speculation budget allows, and the condition is evaluated in place.
+     * The BETA node of the conditional then takes the value of the branch chosen and cancels the other one.
+     */
+    void start_speculation(const CseNode &speculate)
+    {
+        CSE &root = *root_machine;
+        int then_index = std::stoi(speculate.get_value_of_node());
+        std::unique_ptr<Speculation> speculation;
+
+        for (int branch = 0; branch < 2 && nesting < MAX_PARALLEL_NESTING; branch++)
+        {
+            if (root.pool->saturated())
+            {
+                break;
+            }
+            if (root.cheap_structures[then_index + branch])
+            {
+                continue;
+            }
+            if (root.speculating++ >= root.speculationBudget)
+            {
+                root.speculating--;
+                break;
+            }
+
+            if (!speculation)
+            {
+                speculation = std::make_unique<Speculation>();
+                speculation->depth = main_cs.get_nodes().size() - 1;
+                speculation->then_index = then_index;
+            }
+
+            Speculation *started = speculation.get();
+            started->machines[branch] = std::unique_ptr<CSE>(new CSE(this, environment_stack.back()));
+            started->pending++;
+
+            root.pool->submit([started, branch, &root]()
+                              {
+                                  try
+                                  {
+                                      started->machines[branch]->run(started->then_index + branch);
+                                  }
+                                  catch (...)
+                                  {
+                                      started->errors[branch] = std::current_exception();
+                                  }
+                                  root.speculating--;
+                                  started->pending--;
+                              });
+        }
+
+        if (speculation)
+        {
+            speculations.push_back(std::move(speculation));
+        }
+
+        main_cs.push_cs(root.ControlStructs[root.componentOffset + speculate.get_cs_index()]);
+    }
+
+    /**
+     * Ends the speculation of the conditional whose BETA node is evaluated, given the value of the condition.
+     * The branch not chosen is cancelled. When the chosen branch was evaluated ahead its value replaces the DELTA
+     * nodes of the conditional, otherwise the BETA node goes on as usual.
+     * @return Whether the value of the chosen branch was taken.
+     */
+    bool finish_speculation(const CseNode &condition)
+    {
+        std::unique_ptr<Speculation> speculation = std::move(speculations.back());
+        speculations.pop_back();
+
+        int chosen = -1;
+        if (condition.get_type_of_node() == TypeOfObject::BOOLEAN)
+        {
+            chosen = condition.get_value_of_node() == "true" ? 0 : 1;
+        }
+        else if (condition.get_type_of_node() == TypeOfObject::INTEGER)
+        {
+            chosen = condition.get_integer_value().is_zero() ? 1 : 0;
+        }
+
+        for (int branch = 0; branch < 2; branch++)
+        {
+            if (branch != chosen && speculation->machines[branch])
+            {
+                speculation->machines[branch]->cancelled = true;
+            }
+        }
+        root_machine->pool->wait(speculation->pending);
+
+        if (chosen < 0 || !speculation->machines[chosen])
+        {
+            return false;
+        }
+
+        main_cs.pop_last_node();
+        main_cs.pop_last_node();
+        take_over(*speculation->machines[chosen], speculation->errors[chosen]);
+        return true;
+    }
+
+    /**
+     * Turns on the experimental parallel evaluation, before the control structures are created.
+     * Strings are then no longer grown in place, since their buffers are shared between threads.
+     * @param threads The number of threads evaluating the program.
+     */
+    void set_parallel(unsigned threads)
+    {
+        pool = std::make_unique<TaskPool>(threads);
+        RpalString::growInPlace = false;
+    }
+
+    /**
+     * Turns on speculative evaluation of conditionals, after set_parallel and before the control structures are
+     * created.
+     * @param budget The number of branches evaluated ahead at the same time at most.
+     */
+    void set_speculation(int budget)
+    {
+        speculationBudget = budget;
+    }
+
+    // fuse sequences of nodes into superinstructions before evaluation, on by default
+    void set_fusion(bool fuse)
+    {
+        fusion = fuse;
+    }
+
+    // let operator and gamma instructions specialize themselves after their first run, on by default
+    void set_quickening(bool quicken)
+    {
+        quickening = quicken;
+    }
+
+    // number of nodes taken off the control while the program was evaluated
+    long get_dispatches() const
+    {
+        return dispatches;
+    }
+
+    // write the superinstructions fused, the nodes taken off the control and the forms instructions took, for -stats,
+    // along with the sites -types proved
+    void write_stats(std::ostream &out) const
+    {
+        out << "control structure nodes: " << fusion_stats.nodes_before << " before fusion, "
+            << fusion_stats.nodes_after << " after" << std::endl;
+        out << "superinstructions: " << fusion_stats.calls << " call, " << fusion_stats.builtins << " builtin, "
+            << fusion_stats.operations << " operation, " << fusion_stats.branches << " branch" << std::endl;
+        out << "dispatches: " << dispatches << std::endl;
+
+        std::size_t forms[5] = {};
+        std::size_t proven = 0;
+        for (const QuickeningSite &site : quickening_sites)
+        {
+            forms[static_cast<int>(site.form.load())]++;
+            proven += site.proven ? 1 : 0;
+        }
+        out << "quickened sites: " << forms[static_cast<int>(Quickening::INTEGER)] << " integer, "
+            << forms[static_cast<int>(Quickening::CLOSURE)] << " closure, " << forms[static_cast<int>(Quickening::TUPLE)]
+            << " tuple, " << forms[static_cast<int>(Quickening::GENERIC)] << " generic, "
+            << forms[static_cast<int>(Quickening::UNSEEN)] << " not run" << std::endl;
+        out << "proven sites: " << proven << std::endl;
+    }
+
+    // keep the results of calls of pure functions, at most capacity of them
+    void set_memoize(std::size_t capacity)
+    {
+        memo.emplace(capacity);
+    }
+
+    /**
+     * Enters the frame of a call of a closure with the given environment and body. The frame is taken from
+     * frame_stack, no closure refers to it, and its bindings are released when the call returns.
+     * @return The frame of the call, the caller binds the arguments and then pushes the body.
+     */
+    Environment *enter_call(const EnvironmentRef &parent, int body)
+    {
+        if (frame_depth == static_cast<int>(frame_stack.size()))
+        {
+            frame_stack.emplace_back();
+        }
+        Environment *call_environment = &frame_stack[frame_depth];
+        frame_depth++;
+        call_environment->enter(parent, -(frame_base + frame_depth));
+
+        environment_stack.push_back(call_environment);
+        main_cs.append_node(CseNode(TypeOfObject::ENVIRONMENT, std::to_string(call_environment->get_label()), body,
+                                    EnvironmentRef()));
+        return call_environment;
+    }
+
+    // bind the argument of a call to the variable or the tuple parameter of the lambda
+    static void bind_argument(Environment *environment, const CseNode &lambda, const CseNode &argument)
+    {
+        if (lambda.get_is_one_bound_var())
+        {
+            bind_value(environment, lambda.get_symbol(), argument);
+            return;
+        }
+
+        const std::vector<Symbol> &variable_list = lambda.get_bound_variables_list();
+        if (argument.get_type_of_node() != TypeOfObject::LIST)
+        {
+            throw std::runtime_error("Value bound to " + std::to_string(variable_list.size()) + " variables is not a tuple");
+        }
+
+        Span<CseNode> list_items = argument.get_list_elements();
+        if (list_items.size() != variable_list.size())
+        {
+            throw std::runtime_error("Tuple of " + std::to_string(list_items.size()) + " elements bound to " +
+                                     std::to_string(variable_list.size()) + " variables");
+        }
+        environment->bind_elements(variable_list, list_items);
+    }
+
+    // value of a leaf, a constant or an identifier looked up in the current environment
+    CseNode value_of(const CseNode &leaf) const
+    {
+        if (leaf.get_type_of_node() != TypeOfObject::IDENTIFIER)
+        {
+            return leaf;
+        }
+
+        const Environment *environment = environment_stack.back();
+        Symbol identifier = leaf.get_symbol();
+
+        if (const CseNode *variable = environment->find(identifier, BindingKind::VARIABLE))
+        {
+            return variable->value_copy();
+        }
+        else if (const CseNode *lambda = environment->find(identifier, BindingKind::LAMBDA))
+        {
+            return *lambda;
+        }
+        else if (const CseNode *list = environment->find(identifier, BindingKind::LIST))
+        {
+            return *list;
+        }
+        // if node nodeValue is in builtInFunctions add the node to the stack
+        else if (std::find(builtInFunctions.begin(), builtInFunctions.end(), leaf.get_value_of_node()) !=
+                 builtInFunctions.end())
+        {
+            return leaf;
+        }
+        else if (leaf.get_value_of_node() == "nil")
+        {
+            return CseNode(TypeOfObject::LIST, std::vector<CseNode>());
+        }
+
+        throw std::runtime_error("Variable not found: " + leaf.get_value_of_node());
+    }
+
+    // operands of an operator, the values of its leaves or the values on top of the stack, the left one first
+    std::pair<CseNode, CseNode> take_operands(Span<CseNode> operands, bool unary)
+    {
+        if (!operands.empty())
+        {
+            // the right operand is evaluated first, as when the leaves are pushed
+            CseNode second = unary ? CseNode() : value_of(operands[1]);
+            return {value_of(operands[0]), std::move(second)};
+        }
+
+        CseNode first = stack.pop_last_node_return();
+
+        // unary operators take only their operand, the stack may hold nothing below it
+        CseNode second = unary ? CseNode() : stack.pop_last_node_return();
+        return {std::move(first), std::move(second)};
+    }
+
+    static Integer integer_arithmetic(IntegerOperator operator_, const Integer &first, const Integer &second)
+    {
+        switch (operator_)
+        {
+        case IntegerOperator::ADD:
+            return first + second;
+        case IntegerOperator::SUBTRACT:
+            return first - second;
+        case IntegerOperator::MULTIPLY:
+            return first * second;
+        default:
+            return first / second;
+        }
+    }
+
+    static bool integer_comparison(IntegerOperator operator_, const Integer &first, const Integer &second)
+    {
+        switch (operator_)
+        {
+        case IntegerOperator::EQ:
+            return first == second;
+        case IntegerOperator::NE:
+            return first != second;
+        case IntegerOperator::LS:
+            return first < second;
+        case IntegerOperator::LE:
+            return first <= second;
+        case IntegerOperator::GR:
+            return first > second;
+        default:
+            return first >= second;
+        }
+    }
+
+    /**
+     * Applies the operator of an OPERATOR, OPERATION or BRANCH instruction to its leaves, or to the values on top of
+     * the stack when it has none, in the integer form when its site has taken it.
+     */
+    CseNode operate(const CseNode &instruction)
+    {
+        QuickeningSite *site = quickening_site(instruction);
+
+        if (site != nullptr && site->integer_operator != IntegerOperator::NONE)
+        {
+            IntegerOperator operator_ = site->integer_operator;
+            std::pair<CseNode, CseNode> operands = take_operands(instruction.get_operands(),
+                                                                 operator_ == IntegerOperator::NEGATE);
+
+            if (!takes_integers(*site, operands.first, operands.second))
+            {
+                return apply_operator(instruction.get_value_of_node(), operands.first, operands.second);
+            }
+            if (operator_ == IntegerOperator::NEGATE)
+            {
+                return CseNode(-operands.first.integer_value());
+            }
+            if (operator_ >= IntegerOperator::EQ)
+            {
+                bool result = integer_comparison(operator_, operands.first.integer_value(),
+                                                 operands.second.integer_value());
+                return CseNode(TypeOfObject::BOOLEAN, result ? "true" : "false");
+            }
+            return CseNode(integer_arithmetic(operator_, operands.first.integer_value(),
+                                              operands.second.integer_value()));
+        }
+
+        std::string operator_ = instruction.get_value_of_node();
+        std::pair<CseNode, CseNode> operands = take_operands(instruction.get_operands(), operator_arity(operator_) == 1);
+        return apply_operator(operator_, operands.first, operands.second);
+    }
+
+    /**
+     * Whether a BRANCH instruction takes its then branch. The condition is taken off the stack when the instruction
+     * has no operator, and integers are compared without making a truth value when its site has the integer form.
+     */
+    bool branch_condition(const CseNode &instruction)
+    {
+        QuickeningSite *site = quickening_site(instruction);
+
+        if (site != nullptr && site->integer_operator >= IntegerOperator::EQ)
+        {
+            std::pair<CseNode, CseNode> operands = take_operands(instruction.get_operands(), false);
+
+            if (takes_integers(*site, operands.first, operands.second))
+            {
+                return integer_comparison(site->integer_operator, operands.first.integer_value(),
+                                          operands.second.integer_value());
+            }
+            return takes_then_branch(apply_operator(instruction.get_value_of_node(), operands.first, operands.second));
+        }
+
+        if (instruction.get_value_of_node().empty())
+        {
+            return takes_then_branch(stack.pop_last_node_return());
+        }
+        return takes_then_branch(operate(instruction));
+    }
+
+    // whether a conditional takes its then branch, given the value of its condition
+    static bool takes_then_branch(const CseNode &condition)
+    {
+        if (condition.get_type_of_node() == TypeOfObject::BOOLEAN)
+        {
+            return condition.get_value_of_node() == "true";
+        }
+        if (condition.get_type_of_node() == TypeOfObject::INTEGER)
+        {
+            return !condition.get_integer_value().is_zero();
+        }
+
+        throw std::runtime_error("Invalid type for beta: " + condition.get_value_of_node());
+    }
+
+    /**
+     * Applies a function to the argument on top of the stack, for a gamma or CALL instruction with the given site.
+     * A site that has taken the closure or tuple form goes straight to the call or the indexing once its guard holds.
+     */
+    void apply(CseNode function, QuickeningSite *site)
+    {
+        Quickening form = site != nullptr ? quicken_call(*site, function) : Quickening::GENERIC;
+
+        if (form == Quickening::CLOSURE)
+        {
+            call_closure(function);
+        }
+        else if (form == Quickening::TUPLE)
+        {
+            index_tuple(function);
+        }
+        else if (function.get_type_of_node() == TypeOfObject::LAMBDA && memo && recall_call(function))
+        {
+            // the result of the call was kept by an earlier call with the same argument
+        }
+        else if (function.get_type_of_node() == TypeOfObject::LAMBDA)
+        {
+            call_closure(function);
+        }
+        else if (function.get_type_of_node() == TypeOfObject::IDENTIFIER)
+        {
+            apply_builtin(function.get_value_of_node());
+        }
+        else if (function.get_type_of_node() == TypeOfObject::EETA)
+        {
+            CseNode lambda = function.as_closure(TypeOfObject::LAMBDA);
+            stack.append_node(std::move(function));
+            stack.append_node(std::move(lambda));
+
+            main_cs.append_node(CseNode(TypeOfObject::GAMMA, ""));
+            main_cs.append_node(CseNode(TypeOfObject::GAMMA, ""));
+        }
+        else if (function.get_type_of_node() == TypeOfObject::LIST)
+        {
+            index_tuple(function);
+        }
+    }
+
+    // call a closure with the argument on top of the stack
+    void call_closure(const CseNode &closure)
+    {
+        Environment *call_environment = enter_call(closure.get_environment(), closure.get_cs_index());
+        bind_argument(call_environment, closure, stack.pop_last_node_return());
+        main_cs.push_cs(root_machine->ControlStructs[closure.get_cs_index()]);
+    }
+
+    // index a tuple with the argument on top of the stack
+    void index_tuple(const CseNode &tuple)
+    {
+        CseNode secondArg = stack.pop_last_node_return();
+
+        if (secondArg.get_type_of_node() == TypeOfObject::INTEGER)
+        {
+            int64_t index = secondArg.get_integer_value().to_int64();
+            Span<CseNode> elements = tuple.get_list_elements();
+
+            if (index < 1 || index > static_cast<int64_t>(elements.size()))
+            {
+                throw std::runtime_error("Invalid index for tuple: " + secondArg.get_value_of_node());
+            }
+
+            stack.append_node(elements[index - 1]);
+        }
+        else
+        {
+            throw std::runtime_error("Invalid type for Index: " + secondArg.get_value_of_node());
+        }
+    }
+
+    // apply the built-in function with the given name to the argument on top of the stack
+    void apply_builtin(const std::string &identifier)
+    {
+        if (identifier == "Print" || identifier == "print")
+        {
+            print_value(stack.pop_last_node_return());
+            print_count++;
+        }
+        else if (identifier == "Isinteger")
+        {
+            CseNode nodeValue = stack.pop_last_node_return();
+            if (nodeValue.get_type_of_node() == TypeOfObject::INTEGER)
+            {
+                stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
+            }
+            else
+            {
+                stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
+            }
+        }
+        else if (identifier == "Isstring")
+        {
+            CseNode nodeValue = stack.pop_last_node_return();
+            if (nodeValue.get_type_of_node() == TypeOfObject::STRING)
+            {
+                stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
+            }
+            else
+            {
+                stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
+            }
+        }
+        else if (identifier == "Isempty")
+        {
+            CseNode nodeValue = stack.pop_last_node_return();
+            if (nodeValue.get_type_of_node() == TypeOfObject::LIST)
+            {
+                if (nodeValue.get_list_elements().empty())
+                {
+                    stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
+                }
+                else
+                {
+                    stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
+                }
+            }
+            else
+            {
+                throw std::runtime_error("Invalid type for IsEmpty: " + nodeValue.get_value_of_node());
+            }
+        }
+        else if (identifier == "Istuple")
+        {
+            CseNode nodeValue = stack.pop_last_node_return();
+
+            if (nodeValue.get_type_of_node() == TypeOfObject::LIST)
+            {
+                stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
+            }
+            else
+            {
+                stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
+            }
+        }
+        else if (identifier == "Order")
+        {
+            CseNode nodeValue = stack.pop_last_node_return();
+            if (nodeValue.get_type_of_node() == TypeOfObject::LIST)
+            {
+                stack.append_node(CseNode(Integer(static_cast<int64_t>(nodeValue.get_list_elements().size()))));
+            }
+            else
+            {
+                throw std::runtime_error("Invalid type for Order: " + nodeValue.get_value_of_node());
+            }
+        }
+        else if (identifier == "Conc")
+        {
+            CseNode firstArg = stack.pop_last_node_return();
+            CseNode secondArg = stack.pop_last_node_return();
+            main_cs.pop_last_node();
+
+            if (firstArg.get_type_of_node() == TypeOfObject::STRING &&
+                (secondArg.get_type_of_node() == TypeOfObject::STRING ||
+                 secondArg.get_type_of_node() == TypeOfObject::INTEGER))
+            {
+                stack.append_node(CseNode(firstArg.get_string_value().concat(secondArg.get_string_value())));
+            }
+            else
+            {
+                throw std::runtime_error("Invalid type for Conc: " + firstArg.get_value_of_node());
+            }
+        }
+        else if (identifier == "Stem")
+        {
+            CseNode arg = stack.pop_last_node_return();
+
+            if (arg.get_type_of_node() == TypeOfObject::STRING)
+            {
+                stack.append_node(CseNode(arg.get_string_value().stem()));
+            }
+            else
+            {
+                throw std::runtime_error("Invalid type for Stem: " + identifier);
+            }
+        }
+        else if (identifier == "Stern")
+        {
+            CseNode arg = stack.pop_last_node_return();
 
-                        if (lambda.get_type_of_node() == TypeOfObject::LAMBDA)
-                        {
-                            if (lambda.get_is_one_bound_var())
-                            {
-                                stack.append_node(CseNode(TypeOfObject::EETA, lambda.get_value_of_node(), lambda.get_cs_index(),
-                                                          lambda.get_environment()));
-                            }
-                            else
-                            {
-                                stack.append_node(CseNode(TypeOfObject::EETA, lambda.get_cs_index(), lambda.get_bound_variables_list(),
-                                                          lambda.get_environment()));
-                            }
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Invalid type for Y*: " + lambda.get_value_of_node());
-                        }
-                    }
-                    else if (identifier == "ItoS")
-                    {
-                        CseNode arg = stack.pop_last_node_return();
+            if (arg.get_type_of_node() == TypeOfObject::STRING)
+            {
+                stack.append_node(CseNode(arg.get_string_value().stern()));
+            }
+            else
+            {
+                throw std::runtime_error("Invalid type for Stern: " + identifier);
+            }
+        }
+        else if (identifier == "Y*")
+        {
+            CseNode lambda = stack.pop_last_node_return();
 
-                        if (arg.get_type_of_node() == TypeOfObject::INTEGER)
-                        {
-                            stack.append_node(CseNode(TypeOfObject::STRING, arg.get_value_of_node()));
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Invalid type for ItoS: " + arg.get_value_of_node());
-                        }
-                    }
-                }
-                else if (top_of_stack.get_type_of_node() == TypeOfObject::EETA)
-                {
-                    stack.append_node(top_of_stack);
+            if (lambda.get_type_of_node() == TypeOfObject::LAMBDA)
+            {
+                stack.append_node(lambda.as_closure(TypeOfObject::EETA));
+            }
+            else
+            {
+                throw std::runtime_error("Invalid type for Y*: " + lambda.get_value_of_node());
+            }
+        }
+        else if (identifier == "ItoS")
+        {
+            CseNode arg = stack.pop_last_node_return();
 
-                    if (top_of_stack.get_is_one_bound_var())
-                    {
-                        stack.append_node(
-                            CseNode(TypeOfObject::LAMBDA, top_of_stack.get_value_of_node(), top_of_stack.get_cs_index(),
-                                    top_of_stack.get_environment()));
-                    }
-                    else
-                    {
-                        stack.append_node(
-                            CseNode(TypeOfObject::LAMBDA, top_of_stack.get_cs_index(), top_of_stack.get_bound_variables_list(),
-                                    top_of_stack.get_environment()));
-                    }
+            if (arg.get_type_of_node() == TypeOfObject::INTEGER)
+            {
+                stack.append_node(CseNode(TypeOfObject::STRING, arg.get_value_of_node()));
+            }
+            else
+            {
+                throw std::runtime_error("Invalid type for ItoS: " + arg.get_value_of_node());
+            }
+        }
+    }
 
-                    main_cs.append_node(CseNode(TypeOfObject::GAMMA, ""));
-                    main_cs.append_node(CseNode(TypeOfObject::GAMMA, ""));
-                }
-                else if (top_of_stack.get_type_of_node() == TypeOfObject::LIST)
-                {
-                    CseNode secondArg = stack.pop_last_node_return();
+    // heap environment with the given parent, labelled with the next number
+    EnvironmentRef new_environment(EnvironmentRef parent)
+    {
+        return EnvironmentRef(new Environment(std::move(parent), ++root_machine->environment_count));
+    }
 
-                    if (secondArg.get_type_of_node() == TypeOfObject::INTEGER)
-                    {
-                        int index = std::stoi(secondArg.get_value_of_node());
+    void evaluate()
+    {
+        find_free_names();
+        find_curried_bodies();
+        if (memo)
+        {
+            find_pure_bodies();
+        }
+        if (fusion)
+        {
+            fuse_control_structures();
+        }
+        if (quickening)
+        {
+            add_quickening_sites();
+        }
 
-                        int currentIndex = 0;
-                        int listPosElement = 0;
-                        int listSkipElement = 0;
-                        bool isList = false;
+        global_environment = new_environment(EnvironmentRef());
+        environment_stack.push_back(global_environment.get());
 
-                        for (const auto &i : top_of_stack.get_list_elements())
-                        {
-                            if (i.get_type_of_node() == TypeOfObject::LIST && listSkipElement == 0)
-                            {
-                                listSkipElement = std::stoi(i.get_value_of_node());
-                                currentIndex++;
-
-                                if (index == currentIndex)
-                                {
-                                    isList = true;
-                                    break;
-                                }
-                            }
-                            else if (listSkipElement == 0)
-                            {
-                                currentIndex++;
-
-                                if (index == currentIndex)
-                                {
-                                    break;
-                                }
-                            }
-                            else
-                            {
-                                listSkipElement--;
-                            }
-                            listPosElement++;
-                        }
+        run(0);
+    }
 
-                        std::vector<CseNode> listOfElements = std::vector<CseNode>();
+    // evaluate a control structure in the environment on top of environment_stack
+    void run(int csIndex)
+    {
+        // the values of an environment are the ones pushed after it was entered, so only the control marks it
+        main_cs.append_node(CseNode(TypeOfObject::ENVIRONMENT, "0"));
 
-                        if (isList)
-                        {
-                            int length = std::stoi(top_of_stack.get_list_elements()[listPosElement].get_value_of_node());
+        main_cs.push_cs(root_machine->ControlStructs[csIndex]);
 
-                            for (int i = 0; i < length; i++)
-                            {
-                                listOfElements.push_back(top_of_stack.get_list_elements()[listPosElement + i + 1]);
-                            }
+        CseNode top_of_cs = main_cs.pop_last_node_return();
+        unsigned steps = 0;
 
-                            stack.append_node(CseNode(TypeOfObject::LIST, listOfElements));
-                        }
-                        else
-                        {
-                            stack.append_node(top_of_stack.get_list_elements()[listPosElement]);
-                        }
-                    }
-                    else
-                    {
-                        throw std::runtime_error("Invalid type for Index: " + secondArg.get_value_of_node());
-                    }
-                }
+        while ((top_of_cs.get_type_of_node() != TypeOfObject::ENVIRONMENT) || (top_of_cs.get_value_of_node() != "0"))
+        {
+            dispatches++;
+
+            // machines evaluating a branch ahead stop soon after the branch is not taken
+            if (parent_machine != nullptr && ++steps % 1024 == 0 && is_cancelled())
+            {
+                throw std::runtime_error("Evaluation cancelled");
+            }
 
+            if (top_of_cs.get_type_of_node() == TypeOfObject::INTEGER || top_of_cs.get_type_of_node() == TypeOfObject::STRING ||
+                top_of_cs.get_type_of_node() == TypeOfObject::BOOLEAN || top_of_cs.get_type_of_node() == TypeOfObject::LIST)
+            {
+                // constants, including the tuples and truth values folded before evaluation
+                stack.append_node(top_of_cs);
                 top_of_cs = main_cs.pop_last_node_return();
             }
-            else if (top_of_cs.get_type_of_node() == TypeOfObject::ENVIRONMENT)
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::IDENTIFIER)
             {
-                std::vector<CseNode> environmentNodes = {};
+                stack.append_node(value_of(top_of_cs));
 
-                CseNode st_node = stack.pop_last_node_return();
+                top_of_cs = main_cs.pop_last_node_return();
+            }
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::LAMBDA)
+            {
+                stack.append_node(top_of_cs.set_env(capture(top_of_cs.get_cs_index())));
 
-                while (st_node.get_type_of_node() != TypeOfObject::ENVIRONMENT)
-                {
-                    environmentNodes.push_back(st_node);
-                    st_node = stack.pop_last_node_return();
-                }
+                top_of_cs = main_cs.pop_last_node_return();
+            }
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::REC_LAMBDA)
+            {
+                // the captures of a rec closure bind the closure itself, so recursive calls are plain lambda calls
+                EnvironmentRef rec_environment = capture(top_of_cs.get_cs_index());
 
-                // push back the stack from vector
-                for (auto it = environmentNodes.rbegin(); it != environmentNodes.rend(); ++it)
+                CseNode closure = top_of_cs.to_closure(rec_environment);
+                if (rec_environment.get() != nullptr)
                 {
-                    stack.append_node(*it);
+                    rec_environment->append_lambda(top_of_cs.get_recursive_variable(),
+                                                   top_of_cs.to_closure(rec_environment.uncounted()));
                 }
-
-                environment_stack.pop_back();
+                stack.append_node(closure);
 
                 top_of_cs = main_cs.pop_last_node_return();
             }
-            else if (top_of_cs.get_type_of_node() == TypeOfObject::OPERATOR)
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::GAMMA)
             {
-                std::string operator_ = top_of_cs.get_value_of_node();
+                apply(stack.pop_last_node_return(), quickening_site(top_of_cs));
 
-                CseNode first = stack.pop_last_node_return();
-                CseNode second = stack.pop_last_node_return();
+                top_of_cs = main_cs.pop_last_node_return();
+            }
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::GAMMA_N)
+            {
+                int count = top_of_cs.get_cs_index();
+                CseNode function = stack.pop_last_node_return();
+                const std::vector<ControlStructure> &structures = root_machine->ControlStructs;
 
-                if (operator_ == "+")
-                {
-                    stack.append_node(CseNode(TypeOfObject::INTEGER, std::to_string(
-                                                                         std::stoi(first.get_value_of_node()) + std::stoi(second.get_value_of_node()))));
-                }
-                else if (operator_ == "-")
-                {
-                    stack.append_node(CseNode(TypeOfObject::INTEGER, std::to_string(
-                                                                         std::stoi(first.get_value_of_node()) - std::stoi(second.get_value_of_node()))));
-                }
-                else if (operator_ == "/")
-                {
-                    stack.append_node(CseNode(TypeOfObject::INTEGER, std::to_string(
-                                                                         std::stoi(first.get_value_of_node()) / std::stoi(second.get_value_of_node()))));
-                }
-                else if (operator_ == "*")
-                {
-                    stack.append_node(CseNode(TypeOfObject::INTEGER, std::to_string(
-                                                                         std::stoi(first.get_value_of_node()) * std::stoi(second.get_value_of_node()))));
-                }
-                else if (operator_ == "neg")
-                {
-                    stack.append_node(second);
-                    stack.append_node(CseNode(TypeOfObject::INTEGER, std::to_string(-std::stoi(first.get_value_of_node()))));
-                }
-                else if (operator_ == "not")
-                {
-                    stack.append_node(second);
-                    if (first.get_value_of_node() == "true")
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
-                    }
-                    else
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
-                    }
-                }
-                else if (operator_ == "eq")
-                {
-                    if (first.get_value_of_node() == second.get_value_of_node())
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
-                    }
-                    else
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
-                    }
-                }
-                else if (operator_ == "gr")
-                {
-                    if (std::stoi(first.get_value_of_node()) > std::stoi(second.get_value_of_node()))
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
-                    }
-                    else
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
-                    }
-                }
-                else if (operator_ == "ge")
-                {
-                    if (std::stoi(first.get_value_of_node()) >= std::stoi(second.get_value_of_node()))
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
-                    }
-                    else
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
-                    }
-                }
-                else if (operator_ == "ls")
+                if (function.get_type_of_node() == TypeOfObject::LAMBDA && !memo &&
+                    root_machine->curried_depths[function.get_cs_index()] >= count)
                 {
-                    if (std::stoi(first.get_value_of_node()) < std::stoi(second.get_value_of_node()))
+                    // the lambdas of the chain are the only nodes of the bodies before them
+                    int body = function.get_cs_index();
+                    for (int i = 1; i < count; i++)
                     {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
+                        body = structures[body].get_nodes()[0].get_cs_index();
                     }
-                    else
+
+                    Environment *call_environment = enter_call(function.get_environment(), body);
+                    const CseNode *lambda = &function;
+                    for (int i = 0; i < count; i++)
                     {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
+                        bind_argument(call_environment, *lambda, stack.pop_last_node_return());
+                        if (i + 1 < count)
+                        {
+                            lambda = &structures[lambda->get_cs_index()].get_nodes()[0];
+                        }
                     }
+                    main_cs.push_cs(structures[body]);
                 }
-                else if (operator_ == "le")
+                else
                 {
-                    if (std::stoi(first.get_value_of_node()) <= std::stoi(second.get_value_of_node()))
+                    // partial applications, functions returned by calls and the other values are applied one
+                    // argument at a time
+                    stack.append_node(std::move(function));
+                    for (int i = 0; i < count; i++)
                     {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
-                    }
-                    else
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
+                        main_cs.append_node(CseNode(TypeOfObject::GAMMA, ""));
                     }
                 }
-                else if (operator_ == "ne")
+
+                top_of_cs = main_cs.pop_last_node_return();
+            }
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::ENVIRONMENT)
+            {
+                // the value of the call is already on top of the stack, there is no marker below it to remove
+                if (memo)
                 {
-                    if (first.get_value_of_node() != second.get_value_of_node())
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
-                    }
-                    else
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
-                    }
+                    remember_call(stack.get_last_node());
                 }
-                else if (operator_ == "aug")
-                {
-                    if (first.get_type_of_node() == TypeOfObject::LIST)
-                    {
-                        if (second.get_type_of_node() == TypeOfObject::LIST)
-                        {
-                            std::vector<CseNode> firstElements = first.get_list_elements();
-                            std::vector<CseNode> secondElements = second.get_list_elements();
 
-                            firstElements.emplace_back(TypeOfObject::LIST, std::to_string(secondElements.size()));
+                // frames of frame_stack are only used by the call they were taken for
+                environment_stack.back()->leave();
+                environment_stack.pop_back();
+                frame_depth--;
 
-                            for (auto &element : secondElements)
-                            {
-                                firstElements.push_back(element);
-                            }
+                top_of_cs = main_cs.pop_last_node_return();
+            }
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::OPERATOR)
+            {
+                stack.append_node(operate(top_of_cs));
 
-                            stack.append_node(CseNode(TypeOfObject::LIST, firstElements));
-                        }
-                        else if (second.get_type_of_node() == TypeOfObject::INTEGER ||
-                                 second.get_type_of_node() == TypeOfObject::BOOLEAN ||
-                                 second.get_type_of_node() == TypeOfObject::STRING)
-                        {
-                            std::vector<CseNode> firstElements = first.get_list_elements();
+                top_of_cs = main_cs.pop_last_node_return();
+            }
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::OPERATION)
+            {
+                stack.append_node(operate(top_of_cs));
 
-                            firstElements.emplace_back(second.get_type_of_node(), second.get_value_of_node());
-                            stack.append_node(CseNode(TypeOfObject::LIST, firstElements));
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Invalid type for aug: " + second.get_value_of_node());
-                        }
-                    }
-                    else
-                    {
-                        throw std::runtime_error("Invalid type for aug: " + first.get_value_of_node());
-                    }
-                }
-                else if (operator_ == "or")
-                {
-                    if (first.get_value_of_node() == "true" || second.get_value_of_node() == "true")
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
-                    }
-                    else
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
-                    }
-                }
-                else if (operator_ == "&")
+                top_of_cs = main_cs.pop_last_node_return();
+            }
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::CALL)
+            {
+                Span<CseNode> operands = top_of_cs.get_operands();
+                if (operands.size() > 1)
                 {
-                    if (first.get_value_of_node() == "true" && second.get_value_of_node() == "true")
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "true"));
-                    }
-                    else
-                    {
-                        stack.append_node(CseNode(TypeOfObject::BOOLEAN, "false"));
-                    }
+                    stack.append_node(value_of(operands[1]));
                 }
-                else
+                apply(value_of(operands[0]), quickening_site(top_of_cs));
+
+                top_of_cs = main_cs.pop_last_node_return();
+            }
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::BUILTIN)
+            {
+                Span<CseNode> operands = top_of_cs.get_operands();
+                if (!operands.empty())
                 {
-                    throw std::runtime_error("Invalid operator: " + operator_);
+                    stack.append_node(value_of(operands[0]));
                 }
+                apply_builtin(top_of_cs.get_value_of_node());
+
+                top_of_cs = main_cs.pop_last_node_return();
+            }
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::BRANCH)
+            {
+                int branch = top_of_cs.get_cs_index() + (branch_condition(top_of_cs) ? 0 : 1);
+                main_cs.push_cs(root_machine->ControlStructs[branch]);
 
                 top_of_cs = main_cs.pop_last_node_return();
             }
@@ -1209,28 +3600,43 @@ public:
             {
                 std::vector<CseNode> tau_elements;
                 int tau_size = std::stoi(top_of_cs.get_value_of_node());
+                tau_elements.reserve(tau_size);
 
                 for (int i = 0; i < tau_size; i++)
                 {
-                    CseNode node = stack.pop_last_node_return();
+                    tau_elements.push_back(stack.pop_last_node_return());
+                }
 
-                    if (node.get_type_of_node() == TypeOfObject::LIST)
-                    {
-                        std::vector<CseNode> firstElements = node.get_list_elements();
-                        tau_elements.emplace_back(TypeOfObject::LIST, std::to_string(firstElements.size()));
+                stack.append_node(CseNode(TypeOfObject::LIST, std::move(tau_elements)));
 
-                        for (auto &element : firstElements)
-                        {
-                            tau_elements.push_back(element);
-                        }
-                    }
-                    else
-                    {
-                        tau_elements.push_back(node);
-                    }
-                }
+                top_of_cs = main_cs.pop_last_node_return();
+            }
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::PARALLEL)
+            {
+                evaluate_parallel(top_of_cs);
+
+                top_of_cs = main_cs.pop_last_node_return();
+            }
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::SPECULATE)
+            {
+                start_speculation(top_of_cs);
+
+                top_of_cs = main_cs.pop_last_node_return();
+            }
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::BIND)
+            {
+                CseNode value = stack.pop_last_node_return();
+                Environment *environment = environment_stack.back();
 
-                stack.append_node(CseNode(TypeOfObject::LIST, tau_elements));
+                saved_bindings.push_back(environment->save_binding(top_of_cs.get_symbol()));
+                bind_value(environment, top_of_cs.get_symbol(), value);
+
+                top_of_cs = main_cs.pop_last_node_return();
+            }
+            else if (top_of_cs.get_type_of_node() == TypeOfObject::UNBIND)
+            {
+                environment_stack.back()->restore_binding(saved_bindings.back());
+                saved_bindings.pop_back();
 
                 top_of_cs = main_cs.pop_last_node_return();
             }
@@ -1238,75 +3644,23 @@ public:
             {
                 CseNode node = stack.pop_last_node_return();
 
-                if (node.get_type_of_node() == TypeOfObject::BOOLEAN)
+                if (!speculations.empty() && speculations.back()->depth == main_cs.get_nodes().size() &&
+                    finish_speculation(node))
                 {
-                    if (node.get_value_of_node() == "true")
-                    {
-                        main_cs.pop_last_node();
-                        CseNode true_node = main_cs.pop_last_node_return();
-
-                        if (true_node.get_type_of_node() == TypeOfObject::DELTA)
-                        {
-                            main_cs.push_cs(
-                                *ControlStructs[std::stoi(true_node.get_value_of_node())]);
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Invalid type for beta: " + true_node.get_value_of_node());
-                        }
-                    }
-                    else
-                    {
-                        CseNode false_node = main_cs.pop_last_node_return();
-                        main_cs.pop_last_node();
-
-                        if (false_node.get_type_of_node() == TypeOfObject::DELTA)
-                        {
-                            main_cs.push_cs(
-                                *ControlStructs[std::stoi(false_node.get_value_of_node())]);
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Invalid type for beta: " + false_node.get_value_of_node());
-                        }
-                    }
+                    // the value of the branch was evaluated ahead
                 }
-                else if (node.get_type_of_node() == TypeOfObject::INTEGER)
+                else
                 {
-                    if (node.get_value_of_node() != "0")
-                    {
-                        main_cs.pop_last_node();
-                        CseNode true_node = main_cs.pop_last_node_return();
+                    bool then_branch = takes_then_branch(node);
+                    CseNode else_node = main_cs.pop_last_node_return();
+                    CseNode then_node = main_cs.pop_last_node_return();
+                    const CseNode &branch = then_branch ? then_node : else_node;
 
-                        if (true_node.get_type_of_node() == TypeOfObject::DELTA)
-                        {
-                            main_cs.push_cs(
-                                *ControlStructs[std::stoi(true_node.get_value_of_node())]);
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Invalid type for beta: " + true_node.get_value_of_node());
-                        }
-                    }
-                    else
+                    if (branch.get_type_of_node() != TypeOfObject::DELTA)
                     {
-                        CseNode false_node = main_cs.pop_last_node_return();
-                        main_cs.pop_last_node();
-
-                        if (false_node.get_type_of_node() == TypeOfObject::DELTA)
-                        {
-                            main_cs.push_cs(
-                                *ControlStructs[std::stoi(false_node.get_value_of_node())]);
-                        }
-                        else
-                        {
-                            throw std::runtime_error("Invalid type for beta: " + false_node.get_value_of_node());
-                        }
+                        throw std::runtime_error("Invalid type for beta: " + branch.get_value_of_node());
                     }
-                }
-                else
-                {
-                    throw std::runtime_error("Invalid type for beta: " + node.get_value_of_node());
+                    main_cs.push_cs(root_machine->ControlStructs[std::stoi(branch.get_value_of_node())]);
                 }
 
                 top_of_cs = main_cs.pop_last_node_return();
@@ -1317,11 +3671,27 @@ public:
 
 bool is_operator(const std::string &labelOfNode)
 {
-    std::vector<std::string> operators_ = {"+", "-", "/", "*", "aug", "neg", "not", "eq", "gr", "ge", "ls", "le", "ne",
+    std::vector<std::string> operators_ = {"+", "-", "/", "*", "**", "aug", "neg", "not", "eq", "gr", "ge", "ls", "le", "ne",
                                            "or", "&"};
 
     auto it = std::find(operators_.begin(), operators_.end(), labelOfNode);
     return it != operators_.end();
 }
 
+// check if the node is gamma Y* (lambda f (lambda x E)), the standardized form of rec f = fn x. E
+bool is_recursive_binding(const StandardizedNode &root)
+{
+    if (root.getLabel() != "gamma" || root.getChildCount() != 2)
+    {
+        return false;
+    }
+
+    StandardizedNode y_star = root.getChild(0);
+    StandardizedNode rec_lambda = root.getChild(1);
+
+    return y_star.getLabel() == "identifier" && y_star.getValue() == "Y*" &&
+           rec_lambda.getLabel() == "lambda" && rec_lambda.getChild(0).getLabel() == "identifier" &&
+           rec_lambda.getChild(1).getLabel() == "lambda";
+}
+
 #endif // CSE_H
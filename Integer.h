@@ -0,0 +1,630 @@
+#ifndef INTEGER_H
+#define INTEGER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Integer values of the CSE machine.
+ *
+ * Values that fit in 64 bits are kept inline and computed with overflow checks. A result that
+ * overflows is promoted to an arbitrary-precision magnitude, and a result that fits in 64 bits
+ * again is demoted back, so programs that never overflow never allocate.
+ * Magnitudes are immutable and shared between copies of a value.
+ */
+class Integer
+{
+private:
+    using Limbs = std::vector<uint32_t>; // magnitude in base 2^32, least significant limb first, no leading zero limbs
+
+    int64_t small = 0;                // the value, when it fits in 64 bits
+    std::shared_ptr<const Limbs> big; // the magnitude of values that do not fit in 64 bits
+    bool negative = false;            // the sign of values that do not fit in 64 bits
+
+    static const uint64_t LIMB_BASE = uint64_t(1) << 32;
+
+    // remove the leading zero limbs
+    static void trim(Limbs &limbs)
+    {
+        while (!limbs.empty() && limbs.back() == 0)
+        {
+            limbs.pop_back();
+        }
+    }
+
+    static Limbs magnitude_of(uint64_t value)
+    {
+        Limbs limbs;
+        while (value != 0)
+        {
+            limbs.push_back(static_cast<uint32_t>(value));
+            value >>= 32;
+        }
+        return limbs;
+    }
+
+    // magnitude of the value, whichever way it is stored
+    Limbs magnitude() const
+    {
+        if (big != nullptr)
+        {
+            return *big;
+        }
+
+        // the magnitude of the smallest 64 bit value does not fit in 64 bits as a signed value
+        uint64_t value = small < 0 ? uint64_t(0) - static_cast<uint64_t>(small) : static_cast<uint64_t>(small);
+        return magnitude_of(value);
+    }
+
+    bool is_negative() const
+    {
+        return big != nullptr ? negative : small < 0;
+    }
+
+    // value with the given magnitude and sign, stored inline when it fits in 64 bits
+    static Integer from_magnitude(Limbs limbs, bool negative)
+    {
+        trim(limbs);
+
+        if (limbs.size() <= 2)
+        {
+            uint64_t value = limbs.empty() ? 0 : limbs[0];
+            if (limbs.size() == 2)
+            {
+                value |= static_cast<uint64_t>(limbs[1]) << 32;
+            }
+
+            uint64_t limit = static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+            if (value <= limit)
+            {
+                int64_t signedValue = static_cast<int64_t>(value);
+                return Integer(negative ? -signedValue : signedValue);
+            }
+            if (negative && value == limit + 1)
+            {
+                return Integer(std::numeric_limits<int64_t>::min());
+            }
+        }
+
+        Integer result;
+        result.big = std::make_shared<const Limbs>(std::move(limbs));
+        result.negative = negative;
+        return result;
+    }
+
+    static int compare_magnitudes(const Limbs &a, const Limbs &b)
+    {
+        if (a.size() != b.size())
+        {
+            return a.size() < b.size() ? -1 : 1;
+        }
+
+        for (size_t i = a.size(); i-- > 0;)
+        {
+            if (a[i] != b[i])
+            {
+                return a[i] < b[i] ? -1 : 1;
+            }
+        }
+
+        return 0;
+    }
+
+    static Limbs add_magnitudes(const Limbs &a, const Limbs &b)
+    {
+        const Limbs &longer = a.size() >= b.size() ? a : b;
+        const Limbs &shorter = a.size() >= b.size() ? b : a;
+
+        Limbs sum(longer.size() + 1, 0);
+        uint64_t carry = 0;
+
+        for (size_t i = 0; i < longer.size(); i++)
+        {
+            uint64_t digit = carry + longer[i] + (i < shorter.size() ? shorter[i] : 0);
+            sum[i] = static_cast<uint32_t>(digit);
+            carry = digit >> 32;
+        }
+
+        sum[longer.size()] = static_cast<uint32_t>(carry);
+        trim(sum);
+        return sum;
+    }
+
+    // a - b, where a is at least b
+    static Limbs subtract_magnitudes(const Limbs &a, const Limbs &b)
+    {
+        Limbs difference(a.size(), 0);
+        int64_t borrow = 0;
+
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            int64_t digit = static_cast<int64_t>(a[i]) - borrow - (i < b.size() ? static_cast<int64_t>(b[i]) : 0);
+            borrow = digit < 0 ? 1 : 0;
+            difference[i] = static_cast<uint32_t>(digit + (borrow ? static_cast<int64_t>(LIMB_BASE) : 0));
+        }
+
+        trim(difference);
+        return difference;
+    }
+
+    // result += value * base^shift
+    static void add_shifted(Limbs &result, const Limbs &value, size_t shift)
+    {
+        if (result.size() < value.size() + shift + 1)
+        {
+            result.resize(value.size() + shift + 1, 0);
+        }
+
+        uint64_t carry = 0;
+        size_t i = 0;
+        for (; i < value.size(); i++)
+        {
+            uint64_t digit = carry + result[i + shift] + value[i];
+            result[i + shift] = static_cast<uint32_t>(digit);
+            carry = digit >> 32;
+        }
+        for (i += shift; carry != 0; i++)
+        {
+            if (i == result.size())
+            {
+                result.push_back(0);
+            }
+            uint64_t digit = carry + result[i];
+            result[i] = static_cast<uint32_t>(digit);
+            carry = digit >> 32;
+        }
+    }
+
+    // limbs [begin, end) of the magnitude as a magnitude of its own
+    static Limbs slice(const Limbs &limbs, size_t begin, size_t end)
+    {
+        begin = std::min(begin, limbs.size());
+        end = std::min(end, limbs.size());
+
+        Limbs part(limbs.begin() + begin, limbs.begin() + end);
+        trim(part);
+        return part;
+    }
+
+    static Limbs multiply_schoolbook(const Limbs &a, const Limbs &b)
+    {
+        if (a.empty() || b.empty())
+        {
+            return {};
+        }
+
+        Limbs product(a.size() + b.size(), 0);
+
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < b.size(); j++)
+            {
+                uint64_t digit = static_cast<uint64_t>(a[i]) * b[j] + product[i + j] + carry;
+                product[i + j] = static_cast<uint32_t>(digit);
+                carry = digit >> 32;
+            }
+            product[i + b.size()] = static_cast<uint32_t>(carry);
+        }
+
+        trim(product);
+        return product;
+    }
+
+    // (a1 B + a0)(b1 B + b0) = a1 b1 B^2 + ((a0 + a1)(b0 + b1) - a1 b1 - a0 b0) B + a0 b0
+    static Limbs multiply_magnitudes(const Limbs &a, const Limbs &b)
+    {
+        // splitting needs at least two limbs in each operand
+        if (std::min(a.size(), b.size()) < std::max<size_t>(karatsubaThreshold, 2))
+        {
+            return multiply_schoolbook(a, b);
+        }
+
+        size_t half = std::max(a.size(), b.size()) / 2;
+
+        Limbs a0 = slice(a, 0, half), a1 = slice(a, half, a.size());
+        Limbs b0 = slice(b, 0, half), b1 = slice(b, half, b.size());
+
+        Limbs low = multiply_magnitudes(a0, b0);
+        Limbs high = multiply_magnitudes(a1, b1);
+        Limbs middle = multiply_magnitudes(add_magnitudes(a0, a1), add_magnitudes(b0, b1));
+        middle = subtract_magnitudes(subtract_magnitudes(middle, low), high);
+
+        Limbs product = low;
+        add_shifted(product, middle, half);
+        add_shifted(product, high, 2 * half);
+        trim(product);
+        return product;
+    }
+
+    // quotient and remainder of the magnitudes, the divisor is not zero (Knuth, Algorithm D)
+    static void divide_magnitudes(const Limbs &dividend, const Limbs &divisor, Limbs &quotient, Limbs &remainder)
+    {
+        if (compare_magnitudes(dividend, divisor) < 0)
+        {
+            quotient.clear();
+            remainder = dividend;
+            return;
+        }
+
+        if (divisor.size() == 1)
+        {
+            uint64_t rest = 0;
+            quotient.assign(dividend.size(), 0);
+            for (size_t i = dividend.size(); i-- > 0;)
+            {
+                uint64_t current = (rest << 32) | dividend[i];
+                quotient[i] = static_cast<uint32_t>(current / divisor[0]);
+                rest = current % divisor[0];
+            }
+            trim(quotient);
+            remainder = magnitude_of(rest);
+            return;
+        }
+
+        // normalize so that the top bit of the divisor is set, the quotient digit estimates are then off by at most 2
+        int shift = 0;
+        while ((divisor.back() << shift & 0x80000000u) == 0)
+        {
+            shift++;
+        }
+
+        size_t n = divisor.size();
+        size_t m = dividend.size() - n;
+
+        Limbs v(n), u(dividend.size() + 1);
+        for (size_t i = n; i-- > 0;)
+        {
+            v[i] = (divisor[i] << shift) | (shift != 0 && i > 0 ? divisor[i - 1] >> (32 - shift) : 0);
+        }
+        u[dividend.size()] = shift != 0 ? dividend.back() >> (32 - shift) : 0;
+        for (size_t i = dividend.size(); i-- > 0;)
+        {
+            u[i] = (dividend[i] << shift) | (shift != 0 && i > 0 ? dividend[i - 1] >> (32 - shift) : 0);
+        }
+
+        quotient.assign(m + 1, 0);
+
+        for (size_t j = m + 1; j-- > 0;)
+        {
+            uint64_t numerator = (static_cast<uint64_t>(u[j + n]) << 32) | u[j + n - 1];
+            uint64_t estimate = numerator / v[n - 1];
+            uint64_t rest = numerator % v[n - 1];
+
+            while (estimate >= LIMB_BASE || estimate * v[n - 2] > ((rest << 32) | u[j + n - 2]))
+            {
+                estimate--;
+                rest += v[n - 1];
+                if (rest >= LIMB_BASE)
+                {
+                    break;
+                }
+            }
+
+            // subtract estimate * v from the current part of u
+            int64_t borrow = 0;
+            int64_t digit;
+            for (size_t i = 0; i < n; i++)
+            {
+                uint64_t product = estimate * v[i];
+                digit = static_cast<int64_t>(u[i + j]) - borrow - static_cast<int64_t>(product & 0xFFFFFFFFu);
+                u[i + j] = static_cast<uint32_t>(digit);
+                borrow = static_cast<int64_t>(product >> 32) - (digit >> 32);
+            }
+            digit = static_cast<int64_t>(u[j + n]) - borrow;
+            u[j + n] = static_cast<uint32_t>(digit);
+
+            // the estimate was one too large, add v back
+            if (digit < 0)
+            {
+                estimate--;
+                uint64_t carry = 0;
+                for (size_t i = 0; i < n; i++)
+                {
+                    uint64_t sum = static_cast<uint64_t>(u[i + j]) + v[i] + carry;
+                    u[i + j] = static_cast<uint32_t>(sum);
+                    carry = sum >> 32;
+                }
+                u[j + n] += static_cast<uint32_t>(carry);
+            }
+
+            quotient[j] = static_cast<uint32_t>(estimate);
+        }
+
+        trim(quotient);
+
+        remainder.assign(n, 0);
+        for (size_t i = 0; i < n; i++)
+        {
+            remainder[i] = (u[i] >> shift) | (shift != 0 ? u[i + 1] << (32 - shift) : 0);
+        }
+        trim(remainder);
+    }
+
+    // a + b with the sign of each operand given separately, used once the inline values overflow
+    static Integer add_signed(const Limbs &a, bool aNegative, const Limbs &b, bool bNegative)
+    {
+        if (aNegative == bNegative)
+        {
+            return from_magnitude(add_magnitudes(a, b), aNegative);
+        }
+
+        if (compare_magnitudes(a, b) >= 0)
+        {
+            return from_magnitude(subtract_magnitudes(a, b), aNegative);
+        }
+
+        return from_magnitude(subtract_magnitudes(b, a), bNegative);
+    }
+
+public:
+    // Operands shorter than this many limbs are multiplied with the schoolbook method
+    static size_t karatsubaThreshold;
+
+    Integer() = default;
+
+    explicit Integer(int64_t value) : small(value) {}
+
+    /**
+     * Parses a decimal integer with an optional minus sign.
+     * @param text The digits of the integer.
+     * @return The integer.
+     */
+    static Integer parse(const std::string &text)
+    {
+        size_t start = !text.empty() && text[0] == '-' ? 1 : 0;
+
+        if (start == text.size() || text.find_first_not_of("0123456789", start) != std::string::npos)
+        {
+            throw std::runtime_error("Invalid integer: " + text);
+        }
+
+        // up to 18 digits always fit in 64 bits
+        if (text.size() - start <= 18)
+        {
+            return Integer(std::stoll(text));
+        }
+
+        Limbs limbs;
+        for (size_t position = start; position < text.size(); position += 9)
+        {
+            size_t length = std::min<size_t>(9, text.size() - position);
+            uint64_t scale = 1;
+            for (size_t i = 0; i < length; i++)
+            {
+                scale *= 10;
+            }
+
+            // limbs = limbs * scale + the next chunk of digits
+            uint64_t carry = std::stoull(text.substr(position, length));
+            for (uint32_t &limb : limbs)
+            {
+                uint64_t digit = static_cast<uint64_t>(limb) * scale + carry;
+                limb = static_cast<uint32_t>(digit);
+                carry = digit >> 32;
+            }
+            if (carry != 0)
+            {
+                limbs.push_back(static_cast<uint32_t>(carry));
+            }
+        }
+
+        return from_magnitude(limbs, start == 1);
+    }
+
+    std::string to_string() const
+    {
+        if (big == nullptr)
+        {
+            return std::to_string(small);
+        }
+
+        // take off nine decimal digits at a time
+        Limbs rest = *big;
+        std::vector<uint32_t> chunks;
+        while (!rest.empty())
+        {
+            uint64_t remainder = 0;
+            for (size_t i = rest.size(); i-- > 0;)
+            {
+                uint64_t current = (remainder << 32) | rest[i];
+                rest[i] = static_cast<uint32_t>(current / 1000000000u);
+                remainder = current % 1000000000u;
+            }
+            trim(rest);
+            chunks.push_back(static_cast<uint32_t>(remainder));
+        }
+
+        std::string text = negative ? "-" : "";
+        text += std::to_string(chunks.back());
+        for (size_t i = chunks.size() - 1; i-- > 0;)
+        {
+            std::string chunk = std::to_string(chunks[i]);
+            text.append(9 - chunk.size(), '0');
+            text += chunk;
+        }
+        return text;
+    }
+
+    // hash of the value, equal integers have equal hashes
+    size_t hash() const
+    {
+        if (big == nullptr)
+        {
+            return std::hash<int64_t>()(small);
+        }
+
+        size_t result = negative ? 1 : 0;
+        for (uint32_t limb : *big)
+        {
+            result = result * 1000003u + limb;
+        }
+        return result;
+    }
+
+    bool is_zero() const
+    {
+        return big == nullptr && small == 0;
+    }
+
+    /**
+     * Returns the value as a 64 bit integer.
+     * @return The value.
+     */
+    int64_t to_int64() const
+    {
+        if (big != nullptr)
+        {
+            throw std::runtime_error("Integer too large: " + to_string());
+        }
+
+        return small;
+    }
+
+    Integer operator-() const
+    {
+        if (big == nullptr && small != std::numeric_limits<int64_t>::min())
+        {
+            return Integer(-small);
+        }
+
+        return from_magnitude(magnitude(), !is_negative() && !is_zero());
+    }
+
+    Integer operator+(const Integer &other) const
+    {
+        int64_t result;
+        if (big == nullptr && other.big == nullptr && !__builtin_add_overflow(small, other.small, &result))
+        {
+            return Integer(result);
+        }
+
+        return add_signed(magnitude(), is_negative(), other.magnitude(), other.is_negative());
+    }
+
+    Integer operator-(const Integer &other) const
+    {
+        int64_t result;
+        if (big == nullptr && other.big == nullptr && !__builtin_sub_overflow(small, other.small, &result))
+        {
+            return Integer(result);
+        }
+
+        return add_signed(magnitude(), is_negative(), other.magnitude(), !other.is_negative());
+    }
+
+    Integer operator*(const Integer &other) const
+    {
+        int64_t result;
+        if (big == nullptr && other.big == nullptr && !__builtin_mul_overflow(small, other.small, &result))
+        {
+            return Integer(result);
+        }
+
+        return from_magnitude(multiply_magnitudes(magnitude(), other.magnitude()), is_negative() != other.is_negative());
+    }
+
+    // quotient rounded towards zero
+    Integer operator/(const Integer &other) const
+    {
+        if (other.is_zero())
+        {
+            throw std::runtime_error("Division by zero");
+        }
+
+        // the smallest 64 bit value divided by -1 overflows
+        if (big == nullptr && other.big == nullptr &&
+            !(small == std::numeric_limits<int64_t>::min() && other.small == -1))
+        {
+            return Integer(small / other.small);
+        }
+
+        Limbs quotient, remainder;
+        divide_magnitudes(magnitude(), other.magnitude(), quotient, remainder);
+        return from_magnitude(quotient, is_negative() != other.is_negative());
+    }
+
+    /**
+     * Raises the value to the given power by repeated squaring. Like division the result of a
+     * negative power is rounded towards zero, so it is zero unless the value is 1 or -1.
+     * @param exponent The power.
+     * @return The value to the power of the exponent.
+     * @throws std::runtime_error if zero is raised to a negative power or the exponent does not fit in 64 bits.
+     */
+    Integer pow(const Integer &exponent) const
+    {
+        Limbs exponentLimbs = exponent.magnitude();
+        bool oddExponent = !exponentLimbs.empty() && (exponentLimbs[0] & 1);
+
+        // the only values whose powers do not grow, these allow any exponent
+        if (big == nullptr && (small == 1 || small == -1))
+        {
+            return Integer(small == -1 && oddExponent ? -1 : 1);
+        }
+        if (exponent.is_negative())
+        {
+            if (is_zero())
+            {
+                throw std::runtime_error("Division by zero");
+            }
+            return Integer(0);
+        }
+        if (is_zero())
+        {
+            return Integer(exponent.is_zero() ? 1 : 0);
+        }
+
+        uint64_t remaining = static_cast<uint64_t>(exponent.to_int64());
+        Integer result(1);
+        Integer square = *this;
+
+        while (true)
+        {
+            if (remaining & 1)
+            {
+                result = result * square;
+            }
+            remaining >>= 1;
+            if (remaining == 0)
+            {
+                return result;
+            }
+            square = square * square;
+        }
+    }
+
+    // negative, zero or positive when the value is less than, equal to or greater than the other value
+    int compare(const Integer &other) const
+    {
+        if (big == nullptr && other.big == nullptr)
+        {
+            return small < other.small ? -1 : (small > other.small ? 1 : 0);
+        }
+
+        if (is_negative() != other.is_negative())
+        {
+            return is_negative() ? -1 : 1;
+        }
+
+        int magnitudeOrder = compare_magnitudes(magnitude(), other.magnitude());
+        return is_negative() ? -magnitudeOrder : magnitudeOrder;
+    }
+
+    bool operator==(const Integer &other) const { return compare(other) == 0; }
+    bool operator!=(const Integer &other) const { return compare(other) != 0; }
+    bool operator<(const Integer &other) const { return compare(other) < 0; }
+    bool operator<=(const Integer &other) const { return compare(other) <= 0; }
+    bool operator>(const Integer &other) const { return compare(other) > 0; }
+    bool operator>=(const Integer &other) const { return compare(other) >= 0; }
+};
+
+size_t Integer::karatsubaThreshold = 32;
+
+#endif // INTEGER_H
@@ -80,14 +80,7 @@ public:
             std::string number = ss.str();
             return {type_of_token::INTEGER, number};
         } else if (currentChar == '/') {
-            if (currPosition < input.length() && input[currPosition] == '/') {
-                // Skip single-line comment
-                while (currPosition < input.length() && input[currPosition] != '\n') {
-                    currPosition++;
-                }
-                // Recursively call getNextToken to get the next valid token
-                return getNextToken();
-            } else if (isOperatorSymbol(currentChar)) {
+            if (isOperatorSymbol(currentChar)) {
                 std::stringstream ss;
                 ss << currentChar;
                 while (currPosition < input.length() && isOperatorSymbol(input[currPosition])) {
@@ -158,11 +151,21 @@ public:
 
 private:
     /**
-     * @brief Skips whitespace characters in the input string.
+     * @brief Skips whitespace characters and single-line comments in the input string.
      */
     void skipWhitespace() {
-        while (currPosition < input.length() && isspace(input[currPosition])) {
-            currPosition++;
+        while (currPosition < input.length()) {
+            if (isspace(input[currPosition])) {
+                currPosition++;
+            } else if (input[currPosition] == '/' && currPosition + 1 < input.length() &&
+                       input[currPosition + 1] == '/') {
+                // Skip single-line comment
+                while (currPosition < input.length() && input[currPosition] != '\n') {
+                    currPosition++;
+                }
+            } else {
+                break;
+            }
         }
     }
 
@@ -0,0 +1,520 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Tree.h"
+#include "CSE.h"
+
+/**
+ * @brief Constant folding and partial evaluation over the Standardized CustomTree (ST).
+ *
+ * Runs between CustomTree::generate() and CSE::create_cs() when the interpreter is started with -O1:
+ * - operators whose operands are integer, string or truth value literals are replaced by their value,
+ * - conditionals with a constant condition are replaced by the branch that is taken,
+ * - gamma (lambda X E) C, where C is an integer or string literal and no other lambda binds X,
+ *   is replaced by E with C substituted for X,
+ * - tuples of literals become tuple nodes, which the control structure builder builds only once.
+ *
+ * Values are computed with CSE::apply_operator, so a folded program prints exactly what the
+ * original prints. Operations that fail are left in the tree, so the error is still raised when
+ * the program reaches them.
+ *
+ * Afterwards every remaining gamma (lambda X B) E whose binding is not visible to any closure is
+ * rewritten to bind X E B. The control structure builder compiles it into the frame the lambda is
+ * applied in: X is bound in the current environment while B runs, so no closure, environment or
+ * control structure is created for the lambda.
+ */
+class Optimizer
+{
+private:
+    // A step of the walk over the tree, slot is the pointer in the parent that holds the node
+    struct Task
+    {
+        enum class Kind
+        {
+            VISIT,  // optimize the node in the slot
+            FOLD,   // fold the node in the slot, its children are optimized
+            CHOOSE, // replace a conditional by a branch, its condition is optimized
+            APPLY,  // substitute the argument of a gamma into its lambda, the argument is optimized
+            UNBIND  // the substitution for a variable goes out of scope
+        };
+
+        Kind kind;
+        CustomTreeNode **slot;
+        std::string variable; // the variable of an UNBIND task
+    };
+
+    // The code that runs in one environment: the program or the body of a lambda, with the bodies of the lambdas
+    // applied in it that are compiled into the frame. Its nodes are numbered begin to end - 1 in pre-order.
+    struct Frame
+    {
+        size_t begin;
+        size_t end;
+        std::unordered_map<std::string, int> ownOccurrences; // occurrences of variables outside the closures of the frame
+    };
+
+    // A gamma (lambda X B) E, slot is the pointer in the parent that holds the gamma node
+    struct Application
+    {
+        CustomTreeNode **slot;
+        size_t frame;
+    };
+
+    std::unordered_map<std::string, int> binderCounts;                // number of lambdas binding each variable
+    std::unordered_map<std::string, CustomTreeNode *> substitutions; // literals substituted for variables in scope
+    std::vector<Task> tasks;
+
+    std::vector<Frame> frames;
+    std::unordered_map<CustomTreeNode *, size_t> framesOfLambdas;            // the frame of the body of each closure
+    std::unordered_map<std::string, std::vector<size_t>> occurrences; // pre-order numbers of the uses of each variable
+    std::vector<Application> applications;
+
+    Optimizer() = default;
+
+    static bool isLiteral(const CustomTreeNode *node)
+    {
+        const std::string label = node->getLabel();
+        return label == "integer" || label == "string" || label == "true" || label == "false";
+    }
+
+    // The leaf for the value of a folded operator, or nullptr if the value is not an integer, string or truth value
+    static CustomTreeNode *literalOf(const CseNode &value)
+    {
+        switch (value.get_type_of_node())
+        {
+        case TypeOfObject::INTEGER:
+            return new LeafNode("integer", value.get_integer_value().to_string());
+        case TypeOfObject::STRING:
+            return new LeafNode("string", value.get_string_value().str());
+        case TypeOfObject::BOOLEAN:
+            return new LeafNode(value.get_value_of_node(), "");
+        default:
+            return nullptr;
+        }
+    }
+
+    // Counts the lambdas binding each variable, a variable bound only once can not be shadowed
+    void countBinders(CustomTreeNode *root)
+    {
+        std::vector<CustomTreeNode *> pendingNodes = {root};
+
+        while (!pendingNodes.empty())
+        {
+            CustomTreeNode *node = pendingNodes.back();
+            pendingNodes.pop_back();
+
+            if (node->getLabel() == "lambda")
+            {
+                CustomTreeNode *binder = node->getChildren()[0];
+                if (binder->getLabel() == ",")
+                {
+                    for (CustomTreeNode *variable : binder->getChildren())
+                    {
+                        binderCounts[variable->getValue()]++;
+                    }
+                }
+                else
+                {
+                    binderCounts[binder->getValue()]++;
+                }
+            }
+
+            for (CustomTreeNode *child : node->getChildren())
+            {
+                pendingNodes.push_back(child);
+            }
+        }
+    }
+
+    void visit(CustomTreeNode **slot)
+    {
+        CustomTreeNode *node = *slot;
+        const std::string label = node->getLabel();
+        std::vector<CustomTreeNode *> &children = node->getChildren();
+
+        if (label == "identifier")
+        {
+            auto substitution = substitutions.find(node->getValue());
+            if (substitution != substitutions.end())
+            {
+                *slot = new LeafNode(substitution->second->getLabel(), substitution->second->getValue());
+                CustomTreeNode::deleteNodeMemory(node);
+            }
+        }
+        else if (label == "lambda")
+        {
+            // the bound variables are not expressions
+            tasks.push_back({Task::Kind::VISIT, &children[1], {}});
+        }
+        else if (label == "->")
+        {
+            tasks.push_back({Task::Kind::CHOOSE, slot, {}});
+            tasks.push_back({Task::Kind::VISIT, &children[0], {}});
+        }
+        else if (label == "gamma" && children[0]->getLabel() == "lambda" &&
+                 children[0]->getChildren()[0]->getLabel() == "identifier" &&
+                 binderCounts[children[0]->getChildren()[0]->getValue()] == 1)
+        {
+            tasks.push_back({Task::Kind::APPLY, slot, {}});
+            tasks.push_back({Task::Kind::VISIT, &children[1], {}});
+        }
+        else
+        {
+            tasks.push_back({Task::Kind::FOLD, slot, {}});
+            for (size_t i = children.size(); i-- > 0;)
+            {
+                tasks.push_back({Task::Kind::VISIT, &children[i], {}});
+            }
+        }
+    }
+
+    void fold(CustomTreeNode **slot)
+    {
+        CustomTreeNode *node = *slot;
+        std::vector<CustomTreeNode *> &children = node->getChildren();
+
+        if (node->getLabel() == "tau")
+        {
+            for (CustomTreeNode *child : children)
+            {
+                if (!isLiteral(child) && child->getLabel() != "tuple")
+                {
+                    return;
+                }
+            }
+
+            CustomTreeNode *tuple = new InternalNode("tuple");
+            tuple->getChildren() = std::move(children);
+            *slot = tuple;
+            CustomTreeNode::deleteDetachedNode(node);
+        }
+        else if (is_operator(node->getLabel()))
+        {
+            for (CustomTreeNode *child : children)
+            {
+                if (!isLiteral(child))
+                {
+                    return;
+                }
+            }
+
+            CseNode first = CSE::constant_value(StandardizedNode::of(children[0]));
+            CseNode second = children.size() > 1 ? CSE::constant_value(StandardizedNode::of(children[1])) : CseNode();
+            CustomTreeNode *literal;
+
+            try
+            {
+                literal = literalOf(CSE::apply_operator(node->getLabel(), first, second));
+            }
+            catch (std::runtime_error &)
+            {
+                // left for the evaluator, which raises the error when the program gets here
+                return;
+            }
+
+            if (literal != nullptr)
+            {
+                *slot = literal;
+                CustomTreeNode::deleteNodeMemory(node);
+            }
+        }
+    }
+
+    void choose(CustomTreeNode **slot)
+    {
+        CustomTreeNode *node = *slot;
+        std::vector<CustomTreeNode *> &children = node->getChildren();
+        CustomTreeNode *condition = children[0];
+
+        // the same conditions the evaluator accepts for beta, anything else is left to fail at run time
+        int branch = 0;
+        if (condition->getLabel() == "true" || condition->getLabel() == "false")
+        {
+            branch = condition->getLabel() == "true" ? 1 : 2;
+        }
+        else if (condition->getLabel() == "integer")
+        {
+            branch = CSE::constant_value(StandardizedNode::of(condition)).get_integer_value().is_zero() ? 2 : 1;
+        }
+
+        if (branch == 0)
+        {
+            tasks.push_back({Task::Kind::VISIT, &children[2], {}});
+            tasks.push_back({Task::Kind::VISIT, &children[1], {}});
+            return;
+        }
+
+        *slot = children[branch];
+        CustomTreeNode::deleteNodeMemory(condition);
+        CustomTreeNode::deleteNodeMemory(children[3 - branch]);
+        CustomTreeNode::deleteDetachedNode(node);
+
+        tasks.push_back({Task::Kind::VISIT, slot, {}});
+    }
+
+    void apply(CustomTreeNode **slot)
+    {
+        CustomTreeNode *node = *slot;
+        std::vector<CustomTreeNode *> &children = node->getChildren();
+        CustomTreeNode *lambda = children[0];
+        CustomTreeNode *argument = children[1];
+
+        if (argument->getLabel() != "integer" && argument->getLabel() != "string")
+        {
+            // truth values and tuples are bound differently, the lambda is kept
+            tasks.push_back({Task::Kind::VISIT, &children[0], {}});
+            return;
+        }
+
+        CustomTreeNode *binder = lambda->getChildren()[0];
+        *slot = lambda->getChildren()[1];
+
+        // the argument is kept until the substitution goes out of scope
+        substitutions[binder->getValue()] = argument;
+        tasks.push_back({Task::Kind::UNBIND, nullptr, binder->getValue()});
+        tasks.push_back({Task::Kind::VISIT, slot, {}});
+
+        CustomTreeNode::deleteNodeMemory(binder);
+        CustomTreeNode::deleteDetachedNode(lambda);
+        CustomTreeNode::deleteDetachedNode(node);
+    }
+
+    void unbind(const std::string &variable)
+    {
+        CustomTreeNode::deleteNodeMemory(substitutions[variable]);
+        substitutions.erase(variable);
+    }
+
+    /**
+     * Stores in every lambda and conditional node the index of the control structure CSE::create_cs gives it,
+     * visiting the nodes in the order create_cs compiles them. The indices are kept when other nodes are
+     * folded away, so closures print the index they have without optimization.
+     */
+    static void numberControlStructures(CustomTreeNode *root)
+    {
+        int next = 1; // the program is control structure 0
+        std::vector<CustomTreeNode *> pendingNodes = {root};
+        std::vector<CustomTreeNode *> children;
+
+        while (!pendingNodes.empty())
+        {
+            CustomTreeNode *node = pendingNodes.back();
+            pendingNodes.pop_back();
+            children.clear();
+
+            if (node->getLabel() == "lambda")
+            {
+                node->setValue(std::to_string(next++));
+                children.push_back(node->getChildren()[1]);
+            }
+            else if (is_recursive_binding(StandardizedNode::of(node)))
+            {
+                CustomTreeNode *function = node->getChildren()[1]->getChildren()[1];
+                function->setValue(std::to_string(next++));
+                children.push_back(function->getChildren()[1]);
+            }
+            else if (node->getLabel() == "->")
+            {
+                node->setValue(std::to_string(next));
+                next += 2;
+                children = {node->getChildren()[1], node->getChildren()[2], node->getChildren()[0]};
+            }
+            else
+            {
+                children = node->getChildren();
+            }
+
+            pendingNodes.insert(pendingNodes.end(), children.rbegin(), children.rend());
+        }
+    }
+
+    // gamma (lambda X B) E with a single variable X
+    static bool isApplication(CustomTreeNode *node)
+    {
+        return node->getLabel() == "gamma" && node->getChildren()[0]->getLabel() == "lambda" &&
+               node->getChildren()[0]->getChildren()[0]->getLabel() == "identifier";
+    }
+
+    // number of uses of a variable numbered within the frame
+    size_t occurrencesIn(const Frame &frame, const std::string &variable) const
+    {
+        auto uses = occurrences.find(variable);
+        if (uses == occurrences.end())
+        {
+            return 0;
+        }
+
+        auto first = std::lower_bound(uses->second.begin(), uses->second.end(), frame.begin);
+        auto last = std::lower_bound(uses->second.begin(), uses->second.end(), frame.end);
+        return last - first;
+    }
+
+    // Numbers the nodes in pre-order, and records the frames, the uses of variables and the applications of lambdas
+    void findFrames(CustomTreeNode **root)
+    {
+        struct PendingNode
+        {
+            CustomTreeNode **slot;
+            size_t frame;
+            bool applied; // a lambda applied in the frame, its body stays in the frame
+            bool exit;    // the end of the frame of a closure
+        };
+
+        size_t number = 0;
+        frames.push_back({0, 0, {}});
+        std::vector<PendingNode> pendingNodes = {{root, 0, false, false}};
+
+        while (!pendingNodes.empty())
+        {
+            PendingNode pending = pendingNodes.back();
+            pendingNodes.pop_back();
+
+            if (pending.exit)
+            {
+                frames[pending.frame].end = number;
+                continue;
+            }
+
+            CustomTreeNode *node = *pending.slot;
+            std::vector<CustomTreeNode *> &children = node->getChildren();
+            number++;
+
+            if (node->getLabel() == "identifier")
+            {
+                occurrences[node->getValue()].push_back(number - 1);
+                frames[pending.frame].ownOccurrences[node->getValue()]++;
+            }
+            else if (node->getLabel() == "lambda")
+            {
+                // the bound variables are not uses
+                size_t frame = pending.frame;
+                if (!pending.applied)
+                {
+                    frame = frames.size();
+                    frames.push_back({number, 0, {}});
+                    framesOfLambdas[node] = frame;
+                    pendingNodes.push_back({nullptr, frame, false, true});
+                }
+                pendingNodes.push_back({&children[1], frame, false, false});
+            }
+            else
+            {
+                if (isApplication(node))
+                {
+                    applications.push_back({pending.slot, pending.frame});
+                }
+
+                for (size_t i = children.size(); i-- > 0;)
+                {
+                    pendingNodes.push_back({&children[i], pending.frame, i == 0 && isApplication(node), false});
+                }
+            }
+        }
+
+        frames[0].end = number;
+    }
+
+    /**
+     * Whether the binding of an application can live in the frame the lambda is applied in.
+     * Closures look variables up when they are called, which can be before the binding is made or after it
+     * ends, so none of the closures of the frame may use the variable. The only exception is a recursive
+     * function bound to its own name: it finds itself in the frame of its rec closure first.
+     */
+    bool canInline(const Application &application) const
+    {
+        CustomTreeNode *node = *application.slot;
+        const std::string variable = node->getChildren()[0]->getChildren()[0]->getValue();
+        const Frame &frame = frames[application.frame];
+
+        auto own = frame.ownOccurrences.find(variable);
+        size_t closureUses = occurrencesIn(frame, variable) - (own == frame.ownOccurrences.end() ? 0 : own->second);
+
+        CustomTreeNode *argument = node->getChildren()[1];
+        if (is_recursive_binding(StandardizedNode::of(argument)) &&
+            argument->getChildren()[1]->getChildren()[0]->getValue() == variable)
+        {
+            closureUses -= occurrencesIn(frames[framesOfLambdas.at(argument->getChildren()[1])], variable);
+        }
+
+        return closureUses == 0;
+    }
+
+    // Rewrites the applications that can be inlined into bind nodes, the innermost ones first
+    void inlineApplications(CustomTreeNode **root)
+    {
+        findFrames(root);
+
+        for (auto application = applications.rbegin(); application != applications.rend(); ++application)
+        {
+            if (!canInline(*application))
+            {
+                continue;
+            }
+
+            CustomTreeNode *gamma = *application->slot;
+            CustomTreeNode *lambda = gamma->getChildren()[0];
+
+            CustomTreeNode *bind = new InternalNode("bind");
+            bind->appendChild(lambda->getChildren()[0]);
+            bind->appendChild(gamma->getChildren()[1]);
+            bind->appendChild(lambda->getChildren()[1]);
+
+            *application->slot = bind;
+            CustomTreeNode::deleteDetachedNode(lambda);
+            CustomTreeNode::deleteDetachedNode(gamma);
+        }
+    }
+
+    CustomTreeNode *run(CustomTreeNode *root)
+    {
+        numberControlStructures(root);
+        countBinders(root);
+        tasks.push_back({Task::Kind::VISIT, &root, {}});
+
+        while (!tasks.empty())
+        {
+            Task task = tasks.back();
+            tasks.pop_back();
+
+            switch (task.kind)
+            {
+            case Task::Kind::VISIT:
+                visit(task.slot);
+                break;
+            case Task::Kind::FOLD:
+                fold(task.slot);
+                break;
+            case Task::Kind::CHOOSE:
+                choose(task.slot);
+                break;
+            case Task::Kind::APPLY:
+                apply(task.slot);
+                break;
+            case Task::Kind::UNBIND:
+                unbind(task.variable);
+                break;
+            }
+        }
+
+        inlineApplications(&root);
+
+        return root;
+    }
+
+public:
+    /**
+     * @brief Optimizes the Standardized CustomTree (ST) in place, replacing its root if needed.
+     */
+    static void optimize()
+    {
+        CustomTree &tree = CustomTree::getInstance();
+        Optimizer optimizer;
+        tree.setSTRoot(optimizer.run(tree.getSTRoot()));
+    }
+};
+
+#endif // OPTIMIZER_H
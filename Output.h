@@ -0,0 +1,161 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <cerrno>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/**
+ * The output of RPAL programs is collected in a large user-space buffer and written to a file
+ * descriptor with a single system call when the buffer fills up or is flushed explicitly.
+ * The existance of only one writer for the standard output is ensured by using the singleton pattern.
+ * A writer without a file descriptor keeps all of its output in memory, until it is taken with take().
+ */
+class OutputWriter
+{
+private:
+    static const std::size_t BUFFER_SIZE = 1 << 16; // Bytes collected before they are written
+
+    int fileDescriptor; // The file descriptor the output is written to, -1 when the output is kept in memory
+    std::string buffer; // The output not written yet
+
+    // Private copy constructor and assignment operator which prevent duplicating the writer
+    OutputWriter(const OutputWriter &) = delete;
+    OutputWriter &operator=(const OutputWriter &) = delete;
+
+    /**
+     * Writes the given bytes to the file descriptor, retrying until all of them are written.
+     */
+    void writeAll(const char *data, std::size_t size)
+    {
+        while (size > 0)
+        {
+#ifdef _WIN32
+            long written = _write(fileDescriptor, data, static_cast<unsigned int>(size));
+#else
+            long written = ::write(fileDescriptor, data, size);
+#endif
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::runtime_error("Unable to write the output");
+            }
+
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
+    }
+
+public:
+    /**
+     * Creates a writer for the given file descriptor.
+     * @param fileDescriptor The file descriptor to write to.
+     */
+    explicit OutputWriter(int fileDescriptor) : fileDescriptor(fileDescriptor)
+    {
+        buffer.reserve(BUFFER_SIZE);
+    }
+
+    /**
+     * Creates a writer that keeps its output in memory.
+     */
+    OutputWriter() : fileDescriptor(-1) {}
+
+    // The remaining output is written when the writer is destroyed
+    ~OutputWriter()
+    {
+        try
+        {
+            flush();
+        }
+        catch (std::runtime_error &)
+        {
+        }
+    }
+
+    /**
+     * Returns the writer for the standard output.
+     * @return The singleton writer of the standard output.
+     */
+    static OutputWriter &getInstance()
+    {
+        static OutputWriter standardOutput(1);
+        return standardOutput;
+    }
+
+    /**
+     * Adds text to the output. Text that does not fit in the buffer is written straight away.
+     * @param text The text to add.
+     */
+    void write(std::string_view text)
+    {
+        if (fileDescriptor >= 0 && buffer.size() + text.size() > BUFFER_SIZE)
+        {
+            flush();
+
+            if (text.size() >= BUFFER_SIZE)
+            {
+                writeAll(text.data(), text.size());
+                return;
+            }
+        }
+
+        buffer.append(text.data(), text.size());
+    }
+
+    /**
+     * Adds a character to the output.
+     * @param character The character to add.
+     */
+    void write(char character)
+    {
+        if (fileDescriptor >= 0 && buffer.size() == BUFFER_SIZE)
+        {
+            flush();
+        }
+
+        buffer.push_back(character);
+    }
+
+    /**
+     * Writes all collected output to the file descriptor.
+     * Output written through std::cout, such as warnings, is flushed first so the order is kept.
+     */
+    void flush()
+    {
+        if (fileDescriptor < 0)
+        {
+            return;
+        }
+
+        std::cout.flush();
+
+        writeAll(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+    /**
+     * Takes the output kept by a writer without a file descriptor.
+     * @return The output written since it was last taken.
+     */
+    std::string take()
+    {
+        std::string text = std::move(buffer);
+        buffer.clear();
+        return text;
+    }
+};
+
+#endif // OUTPUT_H
@@ -8,27 +8,44 @@
 #include "TreeNode.h"
 
 #include <vector>
+#include <unordered_map>
+
+/**
+ * A grammar rule waiting on the parser's explicit call stack.
+ * Rules are resumable, step records where the rule continues once the rule it called has returned,
+ * so nesting in the input grows the call stack on the heap instead of the C++ stack.
+ */
+struct ParseFrame
+{
+    void (*rule)(ParseFrame &); // The grammar rule to run
+    int step = 0;               // The point the rule resumes from
+    int count = 0;              // Local counter of the rule (number of children to build)
+    size_t operatorBase = 0;    // Start of the rule's pending operators (expression rule only)
+    int operandLevel = 0;       // Prefix operators allowed before the next operand (expression rule only)
+};
+
+/**
+ * An operator of the expression grammar (B to R) waiting for its right operand.
+ */
+struct PendingOperator
+{
+    std::string label; // The label of the node built for the operator
+    int precedence;    // Binding strength, higher binds tighter
+    int arity;         // Number of children taken from the nodeStack
+};
 
 // function prototypes
-void E();
-void Ew();
-void T();
-void Ta();
-void Tc();
-void B();
-void Bt();
-void Bs();
-void Bp();
-void A();
-void At();
-void Af();
-void Ap();
-void R();
+void E(ParseFrame &frame);
+void Ew(ParseFrame &frame);
+void T(ParseFrame &frame);
+void Ta(ParseFrame &frame);
+void Tc(ParseFrame &frame);
+void B(ParseFrame &frame);
 void Rn();
-void D();
-void Da();
-void Dr();
-void Db();
+void D(ParseFrame &frame);
+void Da(ParseFrame &frame);
+void Dr(ParseFrame &frame);
+void Db(ParseFrame &frame);
 void Vb();
 void Vl();
 
@@ -39,6 +56,8 @@ class Parser
 {
 public:
     static std::vector<CustomTreeNode *> nodeStack;
+    static std::vector<ParseFrame> callStack;
+    static std::vector<PendingOperator> operatorStack;
 
     /**
      * Parses the input tokens and constructs the Abstract Syntax CustomTree (AST).
@@ -55,7 +74,7 @@ public:
         }
         else
         {
-            E(); // Start parsing the expression
+            run(E); // Start parsing the expression
 
             // Check if the next token is the end of file token
             if (tokenStorage.top().type == type_of_token::END_OF_FILE)
@@ -70,9 +89,49 @@ public:
             }
         }
     }
+
+    /**
+     * Runs a grammar rule to completion using the explicit call stack.
+     * @param rule The rule to start with.
+     */
+    static void run(void (*rule)(ParseFrame &))
+    {
+        callStack.push_back(ParseFrame{rule});
+
+        while (!callStack.empty())
+        {
+            ParseFrame frame = callStack.back();
+            callStack.pop_back();
+            frame.rule(frame);
+        }
+    }
+
+    /**
+     * Suspends the current rule and calls another one.
+     * @param frame The frame of the calling rule.
+     * @param step The step the calling rule resumes from.
+     * @param rule The rule to call.
+     */
+    static void call(ParseFrame &frame, int step, void (*rule)(ParseFrame &))
+    {
+        frame.step = step;
+        callStack.push_back(frame);
+        callStack.push_back(ParseFrame{rule});
+    }
+
+    /**
+     * Replaces the current rule with another one, used when nothing is left to do after the call.
+     * @param rule The rule to continue with.
+     */
+    static void jump(void (*rule)(ParseFrame &))
+    {
+        callStack.push_back(ParseFrame{rule});
+    }
 };
 
 std::vector<CustomTreeNode *> Parser::nodeStack;
+std::vector<ParseFrame> Parser::callStack;
+std::vector<PendingOperator> Parser::operatorStack;
 
 /**
  * Constructs a new CustomTreeNode with the specified labelOfNode, number of children, leaf status, and nodeValue.
@@ -117,65 +176,77 @@ void build_tree(const std::string &labelOfNode, const int &num, const bool isLea
  *
  * @throws std::runtime_error if a syntax error occurs.
  */
-void E()
+void E(ParseFrame &frame)
 {
     TokenStorage &tokenStorage = TokenStorage::getInstance();
 
-    // Check if the current token is "let"
-    if (tokenStorage.top().nodeValue == "let")
+    switch (frame.step)
     {
-        tokenStorage.pop();
-        D();
-
-        // Check if the next token is "in"
-        if (tokenStorage.top().nodeValue == "in")
+    case 0:
+        // Check if the current token is "let"
+        if (tokenStorage.top().nodeValue == "let")
         {
             tokenStorage.pop();
-            E();
+            Parser::call(frame, 1, D);
         }
-        else
+        // Check if the current token is "fn"
+        else if (tokenStorage.top().nodeValue == "fn")
         {
-            throw std::runtime_error("Syntax Error: 'in' expected");
-        }
+            tokenStorage.pop();
+            int n = 0;
 
-        // Build the "let" node with 2 children
-        build_tree("let", 2, false);
-    }
-    // Check if the current token is "fn"
-    else if (tokenStorage.top().nodeValue == "fn")
-    {
-        tokenStorage.pop();
-        int n = 0;
+            // Process identifiers until a non-identifier token is encountered
+            while (tokenStorage.top().type == type_of_token::IDENTIFIER)
+            {
+                Vb();
+                n++;
+            }
 
-        // Process identifiers until a non-identifier token is encountered
-        while (tokenStorage.top().type == type_of_token::IDENTIFIER)
-        {
-            Vb();
-            n++;
-        }
+            if (n == 0)
+            {
+                throw std::runtime_error("Syntax Error: at least one identifier expected");
+            }
 
-        if (n == 0)
+            // Check if the next token is "."
+            if (tokenStorage.top().nodeValue == ".")
+            {
+                tokenStorage.pop();
+                frame.count = n;
+                Parser::call(frame, 3, E);
+            }
+            else
+            {
+                throw std::runtime_error("Syntax Error: '.' expected");
+            }
+        }
+        else
         {
-            throw std::runtime_error("Syntax Error: at least one identifier expected");
+            Parser::jump(Ew);
         }
+        break;
 
-        // Check if the next token is "."
-        if (tokenStorage.top().nodeValue == ".")
+    case 1:
+        // Check if the next token is "in"
+        if (tokenStorage.top().nodeValue == "in")
         {
             tokenStorage.pop();
-            E();
+            Parser::call(frame, 2, E);
         }
         else
         {
-            throw std::runtime_error("Syntax Error: '.' expected");
+            throw std::runtime_error("Syntax Error: 'in' expected");
         }
+        break;
+
+    case 2:
+        // Build the "let" node with 2 children
+        build_tree("let", 2, false);
+        break;
 
+    case 3:
         // Build the "lambda" node with n+1 children
-        build_tree("lambda", n + 1, false);
-    }
-    else
-    {
-        Ew();
+        build_tree("lambda", frame.count + 1, false);
+        break;
     }
 }
 
@@ -186,17 +257,28 @@ void E()
  *
  * @throws std::runtime_error if a syntax error occurs.
  */
-void Ew()
+void Ew(ParseFrame &frame)
 {
     TokenStorage &tokenStorage = TokenStorage::getInstance();
-    T();
 
-    // Check if the next token is "where"
-    if (tokenStorage.top().nodeValue == "where")
+    switch (frame.step)
     {
-        tokenStorage.pop();
-        Dr();
+    case 0:
+        Parser::call(frame, 1, T);
+        break;
+
+    case 1:
+        // Check if the next token is "where"
+        if (tokenStorage.top().nodeValue == "where")
+        {
+            tokenStorage.pop();
+            Parser::call(frame, 2, Dr);
+        }
+        break;
+
+    case 2:
         build_tree("where", 2, false);
+        break;
     }
 }
 
@@ -207,23 +289,26 @@ void Ew()
  *
  * @throws std::runtime_error if a syntax error occurs.
  */
-void T()
+void T(ParseFrame &frame)
 {
     TokenStorage &tokenStorage = TokenStorage::getInstance();
-    Ta();
-    int n = 0;
+
+    if (frame.step == 0)
+    {
+        Parser::call(frame, 1, Ta);
+        return;
+    }
 
     // Process additional T expressions separated by commas
-    while (tokenStorage.top().nodeValue == ",")
+    if (tokenStorage.top().nodeValue == ",")
     {
         tokenStorage.pop();
-        Ta();
-        n++;
+        frame.count++;
+        Parser::call(frame, 1, Ta);
     }
-
-    if (n > 0)
+    else if (frame.count > 0)
     {
-        build_tree("tau", n + 1, false);
+        build_tree("tau", frame.count + 1, false);
     }
 }
 
@@ -234,17 +319,26 @@ void T()
  *
  * @throws std::runtime_error if a syntax error occurs.
  */
-void Ta()
+void Ta(ParseFrame &frame)
 {
     TokenStorage &tokenStorage = TokenStorage::getInstance();
-    Tc();
+
+    switch (frame.step)
+    {
+    case 0:
+        Parser::call(frame, 1, Tc);
+        return;
+
+    case 2:
+        build_tree("aug", 2, false);
+        break;
+    }
 
     // Process additional Tc expressions separated by "aug" keyword
-    while (tokenStorage.top().nodeValue == "aug")
+    if (tokenStorage.top().nodeValue == "aug")
     {
         tokenStorage.pop();
-        Tc();
-        build_tree("aug", 2, false);
+        Parser::call(frame, 2, Tc);
     }
 }
 
@@ -255,300 +349,266 @@ void Ta()
  *
  * @throws std::runtime_error if a syntax error occurs.
  */
-void Tc()
+void Tc(ParseFrame &frame)
 {
     TokenStorage &tokenStorage = TokenStorage::getInstance();
-    B();
 
-    // Check if the next token is "->"
-    if (tokenStorage.top().nodeValue == "->")
+    switch (frame.step)
     {
-        tokenStorage.pop();
-        Tc();
+    case 0:
+        Parser::call(frame, 1, B);
+        break;
 
+    case 1:
+        // Check if the next token is "->"
+        if (tokenStorage.top().nodeValue == "->")
+        {
+            tokenStorage.pop();
+            Parser::call(frame, 2, Tc);
+        }
+        break;
+
+    case 2:
         // Check if the next token is "|"
         if (tokenStorage.top().nodeValue == "|")
         {
             tokenStorage.pop();
-            Tc();
-            build_tree("->", 3, false);
+            Parser::call(frame, 3, Tc);
         }
         else
         {
             throw std::runtime_error("Syntax Error: '|' expected");
         }
+        break;
+
+    case 3:
+        build_tree("->", 3, false);
+        break;
     }
 }
 
+// Precedences of the expression grammar, higher binds tighter
+const int OR_PRECEDENCE = 1;
+const int AND_PRECEDENCE = 2;
+const int NOT_PRECEDENCE = 3;
+const int COMPARISON_PRECEDENCE = 4;
+const int ADDITIVE_PRECEDENCE = 5;
+const int MULTIPLICATIVE_PRECEDENCE = 6;
+const int POWER_PRECEDENCE = 7;
+const int AT_PRECEDENCE = 8;
+const int APPLICATION_PRECEDENCE = 9;
+
+// Prefix operators allowed before an operand: "not" and the signs (Bs), only the signs (A), none (At and below)
+const int ANY_PREFIX = 0;
+const int SIGN_PREFIX = 1;
+const int NO_PREFIX = 2;
+
 /**
- * Parses the expression starting with B.
- * Handles the grammar rule B -> Bt { "or" Bt }.
- * Constructs the Abstract Syntax CustomTree (AST) nodes and builds the customTree accordingly.
- *
- * @throws std::runtime_error if a syntax error occurs.
+ * A binary operator token of the expression grammar.
  */
-void B()
+struct BinaryOperator
 {
-    TokenStorage &tokenStorage = TokenStorage::getInstance();
-    Bt();
-
-    // Process additional Bt expressions separated by "or" keyword
-    while (tokenStorage.top().nodeValue == "or")
-    {
-        tokenStorage.pop();
-        Bt();
-        build_tree("or", 2, false);
-    }
-}
+    std::string label; // The label of the node built for the operator
+    int precedence;    // Binding strength, higher binds tighter
+    int operandLevel;  // Prefix operators allowed before the right operand
+};
 
 /**
- * Parses the expression starting with Bt.
- * Handles the grammar rule Bt -> Bs { "&" Bs }.
- * Constructs the Abstract Syntax CustomTree (AST) nodes and builds the customTree accordingly.
- *
- * @throws std::runtime_error if a syntax error occurs.
+ * Looks up the binary operator for a token value.
+ * @param value The token value.
+ * @return The operator, or nullptr if the token is not a binary operator of the expression grammar.
  */
-void Bt()
+const BinaryOperator *find_binary_operator(const std::string &value)
 {
-    TokenStorage &tokenStorage = TokenStorage::getInstance();
-    Bs();
-
-    // Process additional Bs expressions separated by "&" keyword
-    while (tokenStorage.top().nodeValue == "&")
-    {
-        tokenStorage.pop();
-        Bs();
-        build_tree("&", 2, false);
-    }
+    static const std::unordered_map<std::string, BinaryOperator> binaryOperators = {
+        {"or", {"or", OR_PRECEDENCE, ANY_PREFIX}},
+        {"&", {"&", AND_PRECEDENCE, ANY_PREFIX}},
+        {"gr", {"gr", COMPARISON_PRECEDENCE, SIGN_PREFIX}},
+        {">", {"gr", COMPARISON_PRECEDENCE, SIGN_PREFIX}},
+        {"ge", {"ge", COMPARISON_PRECEDENCE, SIGN_PREFIX}},
+        {">=", {"ge", COMPARISON_PRECEDENCE, SIGN_PREFIX}},
+        {"ls", {"ls", COMPARISON_PRECEDENCE, SIGN_PREFIX}},
+        {"<", {"ls", COMPARISON_PRECEDENCE, SIGN_PREFIX}},
+        {"le", {"le", COMPARISON_PRECEDENCE, SIGN_PREFIX}},
+        {"<=", {"le", COMPARISON_PRECEDENCE, SIGN_PREFIX}},
+        {"eq", {"eq", COMPARISON_PRECEDENCE, SIGN_PREFIX}},
+        {"=", {"eq", COMPARISON_PRECEDENCE, SIGN_PREFIX}},
+        {"ne", {"ne", COMPARISON_PRECEDENCE, SIGN_PREFIX}},
+        {"!=", {"ne", COMPARISON_PRECEDENCE, SIGN_PREFIX}},
+        {"+", {"+", ADDITIVE_PRECEDENCE, NO_PREFIX}},
+        {"-", {"-", ADDITIVE_PRECEDENCE, NO_PREFIX}},
+        {"*", {"*", MULTIPLICATIVE_PRECEDENCE, NO_PREFIX}},
+        {"/", {"/", MULTIPLICATIVE_PRECEDENCE, NO_PREFIX}},
+        {"**", {"**", POWER_PRECEDENCE, NO_PREFIX}}};
+
+    auto it = binaryOperators.find(value);
+    return it == binaryOperators.end() ? nullptr : &it->second;
 }
 
 /**
- * Parses the expression starting with Bs.
- * Handles the grammar rule Bs -> "not" Bp | Bp.
- * Constructs the Abstract Syntax CustomTree (AST) nodes and builds the customTree accordingly.
- *
- * @throws std::runtime_error if a syntax error occurs.
+ * Checks if a token can start an Rn, in which case it is applied to the expression before it.
+ * @param token The token to check.
+ * @return True if the token starts an operand.
  */
-void Bs()
+bool starts_operand(const Token &token)
 {
-    TokenStorage &tokenStorage = TokenStorage::getInstance();
-    if (tokenStorage.top().nodeValue == "not")
-    {
-        tokenStorage.pop();
-        Bp();
-        build_tree("not", 1, false);
-    }
-    else
-    {
-        Bp();
-    }
+    return token.type == type_of_token::IDENTIFIER || token.type == type_of_token::INTEGER ||
+           token.type == type_of_token::STRING || token.nodeValue == "true" || token.nodeValue == "false" ||
+           token.nodeValue == "nil" || token.nodeValue == "(" || token.nodeValue == "dummy";
 }
 
 /**
- * Parses the expression starting with Bp.
- * Handles the grammar rule Bp -> A { comparison_operator A }.
- * Constructs the Abstract Syntax CustomTree (AST) nodes and builds the customTree accordingly.
- *
- * @throws std::runtime_error if a syntax error occurs.
+ * Builds the nodes of the pending operators that bind at least as tight as the given precedence.
+ * @param base The start of the current expression's operators on the operator stack.
+ * @param precedence The precedence of the incoming operator.
  */
-void Bp()
+void reduce_operators(size_t base, int precedence)
 {
-    TokenStorage &tokenStorage = TokenStorage::getInstance();
-    A();
-
-    // Check for comparison operators
-    if (tokenStorage.top().nodeValue == "gr" || tokenStorage.top().nodeValue == ">")
-    {
-        tokenStorage.pop();
-        A();
-        build_tree("gr", 2, false);
-    }
-    else if (tokenStorage.top().nodeValue == "ge" || tokenStorage.top().nodeValue == ">=")
+    while (Parser::operatorStack.size() > base && Parser::operatorStack.back().precedence >= precedence)
     {
-        tokenStorage.pop();
-        A();
-        build_tree("ge", 2, false);
-    }
-    else if (tokenStorage.top().nodeValue == "ls" || tokenStorage.top().nodeValue == "<")
-    {
-        tokenStorage.pop();
-        A();
-        build_tree("ls", 2, false);
-    }
-    else if (tokenStorage.top().nodeValue == "le" || tokenStorage.top().nodeValue == "<=")
-    {
-        tokenStorage.pop();
-        A();
-        build_tree("le", 2, false);
-    }
-    else if (tokenStorage.top().nodeValue == "eq" || tokenStorage.top().nodeValue == "=")
-    {
-        tokenStorage.pop();
-        A();
-        build_tree("eq", 2, false);
-    }
-    else if (tokenStorage.top().nodeValue == "ne" || tokenStorage.top().nodeValue == "!=")
-    {
-        tokenStorage.pop();
-        A();
-        build_tree("ne", 2, false);
+        build_tree(Parser::operatorStack.back().label, Parser::operatorStack.back().arity, false);
+        Parser::operatorStack.pop_back();
     }
 }
 
 /**
- * Parses the expression starting with A.
- * Handles the grammar rule A -> + At | - At | At { + At | - At }.
+ * Parses the expression starting with B by precedence climbing.
+ * Handles the grammar rules
+ *   B -> B "or" Bt | Bt,    Bt -> Bt "&" Bs | Bs,    Bs -> "not" Bp | Bp,    Bp -> A [ comparison_operator A ],
+ *   A -> A "+" At | A "-" At | "+" At | "-" At | At,    At -> At "*" Af | At "/" Af | Af,    Af -> Af "**" Ap | Ap,
+ *   Ap -> Ap "@" identifier R | R,    R -> R Rn | Rn.
+ * Operators wait on the operator stack until an operator that binds looser arrives, so the whole
+ * expression is parsed in one loop and only parenthesized expressions go through the call stack.
  * Constructs the Abstract Syntax CustomTree (AST) nodes and builds the customTree accordingly.
  *
  * @throws std::runtime_error if a syntax error occurs.
  */
-void A()
+void B(ParseFrame &frame)
 {
     TokenStorage &tokenStorage = TokenStorage::getInstance();
+    bool expectOperand = true;
 
-    // Check for unary plus operator
-    if (tokenStorage.top().nodeValue == "+")
+    if (frame.step == 0)
     {
-        tokenStorage.pop();
-        At();
-    }
-    // Check for unary minus operator
-    else if (tokenStorage.top().nodeValue == "-")
-    {
-        tokenStorage.pop();
-        At();
-        build_tree("neg", 1, false);
+        frame.operatorBase = Parser::operatorStack.size();
+        frame.operandLevel = ANY_PREFIX;
     }
     else
     {
-        At();
-    }
-
-    // Check for addition and subtraction operators
-    while (tokenStorage.top().nodeValue == "+" || tokenStorage.top().nodeValue == "-")
-    {
-        if (tokenStorage.top().nodeValue == "+")
+        // Returning from a parenthesized expression
+        if (tokenStorage.top().nodeValue == ")")
         {
             tokenStorage.pop();
-            At();
-            build_tree("+", 2, false);
         }
-        else if (tokenStorage.top().nodeValue == "-")
+        else
         {
-            tokenStorage.pop();
-            At();
-            build_tree("-", 2, false);
+            throw std::runtime_error("Syntax Error: ')' expected");
         }
+        expectOperand = false;
     }
-}
 
-/**
- * Parses the expression starting with At.
- * Handles the grammar rule At -> Af { * Af | / Af }.
- * Constructs the Abstract Syntax CustomTree (AST) nodes and builds the customTree accordingly.
- *
- * @throws std::runtime_error if a syntax error occurs.
- */
-void At()
-{
-    TokenStorage &tokenStorage = TokenStorage::getInstance();
-    Af();
-
-    // Check for multiplication and division operators
-    while (tokenStorage.top().nodeValue == "*" || tokenStorage.top().nodeValue == "/")
+    while (true)
     {
-        if (tokenStorage.top().nodeValue == "*")
+        const Token &top = tokenStorage.top();
+
+        if (expectOperand)
         {
-            tokenStorage.pop();
-            Af();
-            build_tree("*", 2, false);
+            if (top.nodeValue == "not" && frame.operandLevel == ANY_PREFIX)
+            {
+                tokenStorage.pop();
+                Parser::operatorStack.push_back({"not", NOT_PRECEDENCE, 1});
+                frame.operandLevel = SIGN_PREFIX;
+            }
+            // Check for unary plus operator
+            else if (top.nodeValue == "+" && frame.operandLevel != NO_PREFIX)
+            {
+                tokenStorage.pop();
+                frame.operandLevel = NO_PREFIX;
+            }
+            // Check for unary minus operator
+            else if (top.nodeValue == "-" && frame.operandLevel != NO_PREFIX)
+            {
+                tokenStorage.pop();
+                Parser::operatorStack.push_back({"neg", ADDITIVE_PRECEDENCE, 1});
+                frame.operandLevel = NO_PREFIX;
+            }
+            else if (top.nodeValue == "(")
+            {
+                tokenStorage.pop();
+                Parser::call(frame, 1, E);
+                return;
+            }
+            else
+            {
+                Rn();
+                expectOperand = false;
+            }
         }
-        else if (tokenStorage.top().nodeValue == "/")
+        // Check for function application
+        else if (starts_operand(top))
         {
-            tokenStorage.pop();
-            Af();
-            build_tree("/", 2, false);
+            reduce_operators(frame.operatorBase, APPLICATION_PRECEDENCE);
+            Parser::operatorStack.push_back({"gamma", APPLICATION_PRECEDENCE, 2});
+            frame.operandLevel = NO_PREFIX;
+            expectOperand = true;
         }
-    }
-}
-
-/**
- * Parses the expression starting with Af.
- * Handles the grammar rule Af -> Ap { ** Ap }.
- * Constructs the Abstract Syntax CustomTree (AST) nodes and builds the customTree accordingly.
- *
- * @throws std::runtime_error if a syntax error occurs.
- */
-void Af()
-{
-    TokenStorage &tokenStorage = TokenStorage::getInstance();
-    Ap();
-
-    // Check for exponentiation operator
-    while (tokenStorage.top().nodeValue == "**")
-    {
-        tokenStorage.pop();
-        Ap();
-        build_tree("**", 2, false);
-    }
-}
-
-/**
- * Parses the expression starting with Ap.
- * Handles the grammar rule Ap -> R { @ identifier R }.
- * Constructs the Abstract Syntax CustomTree (AST) nodes and builds the customTree accordingly.
- *
- * @throws std::runtime_error if a syntax error occurs.
- */
-void Ap()
-{
-    TokenStorage &tokenStorage = TokenStorage::getInstance();
-    R();
+        // Check for infix function application operator
+        else if (top.nodeValue == "@")
+        {
+            reduce_operators(frame.operatorBase, AT_PRECEDENCE);
+            tokenStorage.pop();
 
-    // Check for function application operator
-    while (tokenStorage.top().nodeValue == "@")
-    {
-        tokenStorage.pop();
+            // Check for identifier token
+            if (tokenStorage.top().type == type_of_token::IDENTIFIER)
+            {
+                Token token = tokenStorage.pop();
+                build_tree("identifier", 0, true, token.nodeValue);
+            }
+            else
+            {
+                throw std::runtime_error("Syntax Error: Identifier expected");
+            }
 
-        // Check for identifier token
-        if (tokenStorage.top().type == type_of_token::IDENTIFIER)
-        {
-            Token token = tokenStorage.pop();
-            build_tree("identifier", 0, true, token.nodeValue);
+            Parser::operatorStack.push_back({"@", AT_PRECEDENCE, 3});
+            frame.operandLevel = NO_PREFIX;
+            expectOperand = true;
         }
         else
         {
-            throw std::runtime_error("Syntax Error: Identifier expected");
-        }
+            const BinaryOperator *op = find_binary_operator(top.nodeValue);
 
-        R();
-        build_tree("@", 3, false);
-    }
-}
+            if (op == nullptr)
+            {
+                break;
+            }
 
-/**
- * Parses the expression starting with R.
- * Handles the grammar rule R -> Rn { Rn }.
- * Constructs the Abstract Syntax CustomTree (AST) nodes and builds the customTree accordingly.
- *
- * @throws std::runtime_error if a syntax error occurs.
- */
-void R()
-{
-    TokenStorage &tokenStorage = TokenStorage::getInstance();
-    Rn();
+            if (op->precedence == COMPARISON_PRECEDENCE)
+            {
+                // Comparisons do not chain, a second one ends the expression
+                reduce_operators(frame.operatorBase, COMPARISON_PRECEDENCE + 1);
+                if (Parser::operatorStack.size() > frame.operatorBase &&
+                    Parser::operatorStack.back().precedence == COMPARISON_PRECEDENCE)
+                {
+                    break;
+                }
+            }
+            else
+            {
+                reduce_operators(frame.operatorBase, op->precedence);
+            }
 
-    Token top = tokenStorage.top();
-    while (top.type == type_of_token::IDENTIFIER || top.type == type_of_token::INTEGER || top.type == type_of_token::STRING || top.nodeValue == "true" || top.nodeValue == "false" || top.nodeValue == "nil" || top.nodeValue == "(" || top.nodeValue == "dummy")
-    {
-        Rn();
-        top = tokenStorage.top();
-        build_tree("gamma", 2, false);
+            tokenStorage.pop();
+            Parser::operatorStack.push_back({op->label, op->precedence, 2});
+            frame.operandLevel = op->operandLevel;
+            expectOperand = true;
+        }
     }
+
+    reduce_operators(frame.operatorBase, 0);
 }
 
 /**
- * Parses the expression starting with Rn.
+ * Parses the expression starting with Rn, except for parenthesized expressions which are handled by B.
  * Handles the grammar rule Rn -> identifier | integer | string | true | false | nil | ( E ) | dummy.
  * Constructs the Abstract Syntax CustomTree (AST) nodes and builds the customTree accordingly.
  *
@@ -595,19 +655,6 @@ void Rn()
         tokenStorage.pop();
         build_tree("nil", 0, true);
     }
-    else if (top.nodeValue == "(")
-    {
-        tokenStorage.pop();
-        E();
-        if (tokenStorage.top().nodeValue == ")")
-        {
-            tokenStorage.pop();
-        }
-        else
-        {
-            throw std::runtime_error("Syntax Error: ')' expected");
-        }
-    }
     else if (top.nodeValue == "dummy")
     {
         // Parse dummy
@@ -627,16 +674,25 @@ void Rn()
  *
  * @throws std::runtime_error if a syntax error occurs.
  */
-void D()
+void D(ParseFrame &frame)
 {
     TokenStorage &tokenStorage = TokenStorage::getInstance();
-    Da();
 
-    while (tokenStorage.top().nodeValue == "within")
+    switch (frame.step)
     {
-        tokenStorage.pop();
-        D();
+    case 0:
+        Parser::call(frame, 1, Da);
+        return;
+
+    case 2:
         build_tree("within", 2, false);
+        break;
+    }
+
+    if (tokenStorage.top().nodeValue == "within")
+    {
+        tokenStorage.pop();
+        Parser::call(frame, 2, D);
     }
 }
 
@@ -647,21 +703,25 @@ void D()
  *
  * @throws std::runtime_error if a syntax error occurs.
  */
-void Da()
+void Da(ParseFrame &frame)
 {
     TokenStorage &tokenStorage = TokenStorage::getInstance();
-    Dr();
-    int n = 0;
 
-    while (tokenStorage.top().nodeValue == "and")
+    if (frame.step == 0)
+    {
+        Parser::call(frame, 1, Dr);
+        return;
+    }
+
+    if (tokenStorage.top().nodeValue == "and")
     {
         tokenStorage.pop();
-        Dr();
-        n++;
+        frame.count++;
+        Parser::call(frame, 1, Dr);
     }
-    if (n > 0)
+    else if (frame.count > 0)
     {
-        build_tree("and", n + 1, false);
+        build_tree("and", frame.count + 1, false);
     }
 }
 
@@ -672,19 +732,22 @@ void Da()
  *
  * @throws std::runtime_error if a syntax error occurs.
  */
-void Dr()
+void Dr(ParseFrame &frame)
 {
     TokenStorage &tokenStorage = TokenStorage::getInstance();
 
-    if (tokenStorage.top().nodeValue == "rec")
+    if (frame.step == 1)
     {
-        tokenStorage.pop();
-        Db();
         build_tree("rec", 1, false);
     }
+    else if (tokenStorage.top().nodeValue == "rec")
+    {
+        tokenStorage.pop();
+        Parser::call(frame, 1, Db);
+    }
     else
     {
-        Db();
+        Parser::jump(Db);
     }
 }
 
@@ -695,15 +758,13 @@ void Dr()
  *
  * @throws std::runtime_error if a syntax error occurs.
  */
-void Db()
+void Db(ParseFrame &frame)
 {
     TokenStorage &tokenStorage = TokenStorage::getInstance();
 
-    if (tokenStorage.top().nodeValue == "(")
+    switch (frame.step)
     {
-        tokenStorage.pop();
-        D();
-
+    case 1:
         if (tokenStorage.top().nodeValue == ")")
         {
             tokenStorage.pop();
@@ -712,6 +773,21 @@ void Db()
         {
             throw std::runtime_error("Syntax Error: ')' expected");
         }
+        return;
+
+    case 2:
+        build_tree("=", 2, false);
+        return;
+
+    case 3:
+        build_tree("fcn_form", frame.count + 2, false);
+        return;
+    }
+
+    if (tokenStorage.top().nodeValue == "(")
+    {
+        tokenStorage.pop();
+        Parser::call(frame, 1, D);
     }
     else if (tokenStorage.top().type == type_of_token::IDENTIFIER)
     {
@@ -727,8 +803,7 @@ void Db()
             if (tokenStorage.top().nodeValue == "=")
             {
                 tokenStorage.pop();
-                E();
-                build_tree("=", 2, false);
+                Parser::call(frame, 2, E);
             }
             else
             {
@@ -747,28 +822,6 @@ void Db()
 
             if (tokenStorage.top().nodeValue == "(")
             {
-                //                tokenStorage.pop();
-                //                while (tokenStorage.top().nodeValue != ")")
-                //                {
-                //                    Vb();
-                //                    if (tokenStorage.top().nodeValue == ",")
-                //                    {
-                //                        tokenStorage.pop();
-                //                    }
-                //                    else
-                //                    {
-                //                        n++;
-                //                        break;
-                //                    }
-                //                    n++;
-                //                }
-                //
-                //                if (tokenStorage.top().nodeValue == ")") {
-                //                    tokenStorage.pop();
-                //                }
-                //                else {
-                //                    throw std::runtime_error("Syntax Error: ')' expected");
-                //                }
                 Vb();
                 n++;
             }
@@ -776,14 +829,13 @@ void Db()
             if (n == 0 && tokenStorage.top().nodeValue == "=")
             {
                 tokenStorage.pop();
-                E();
-                build_tree("=", 2, false);
+                Parser::call(frame, 2, E);
             }
             else if (n != 0 && tokenStorage.top().nodeValue == "=")
             {
                 tokenStorage.pop();
-                E();
-                build_tree("fcn_form", n + 2, false);
+                frame.count = n;
+                Parser::call(frame, 3, E);
             }
             else
             {
@@ -893,4 +945,4 @@ void Vl()
     }
 }
 
-#endif // RPAL_CLION_PARSER_H
\ No newline at end of file
+#endif // RPAL_CLION_PARSER_H
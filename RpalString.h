@@ -0,0 +1,189 @@
+#ifndef RPAL_STRING_H
+#define RPAL_STRING_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * String values of the CSE machine.
+ *
+ * A string is a slice (offset and length) of a buffer shared by every string derived from it,
+ * so Stem and Stern only narrow the slice and never copy characters.
+ * A buffer can grow at both ends: when Conc appends to the string that ends the buffer, or prepends
+ * to the string that starts it, the characters are added in place, so strings built one piece at a
+ * time cost amortized linear time. Slices are never changed by this, since the characters they
+ * cover stay where they are.
+ * Characters are only copied out when a plain std::string is needed, for example when printing.
+ * Growing a buffer in place is not safe when strings are used by several threads, growInPlace turns it off.
+ */
+class RpalString
+{
+private:
+    /**
+     * Storage shared by slices. Positions of slices are logical positions, the character at
+     * logical position i is stored at data[origin + i], so growing at the front keeps them valid.
+     */
+    struct Buffer
+    {
+        std::string data;
+        std::ptrdiff_t origin = 0; // index in data of logical position 0
+        std::ptrdiff_t first = 0;  // logical position of the first used character
+        std::ptrdiff_t last = 0;   // logical position one past the last used character
+    };
+
+    std::shared_ptr<Buffer> buffer; // null for the empty string
+    std::ptrdiff_t offset = 0;      // logical position of the first character of the slice
+    std::size_t size = 0;           // number of characters of the slice
+
+    RpalString(std::shared_ptr<Buffer> buffer, std::ptrdiff_t offset, std::size_t size)
+        : buffer(std::move(buffer)), offset(offset), size(size) {}
+
+    // whether the slice ends where the used part of its buffer ends
+    bool ends_buffer() const
+    {
+        return buffer != nullptr && offset + static_cast<std::ptrdiff_t>(size) == buffer->last;
+    }
+
+    // whether the slice starts where the used part of its buffer starts
+    bool starts_buffer() const
+    {
+        return buffer != nullptr && offset == buffer->first;
+    }
+
+    // add characters after the used part of the buffer
+    static void append_to(Buffer &buffer, std::string_view text)
+    {
+        buffer.data.append(text.data(), text.size());
+        buffer.last += static_cast<std::ptrdiff_t>(text.size());
+    }
+
+    // add characters before the used part of the buffer, the free space in front is doubled when it runs out
+    static void prepend_to(Buffer &buffer, std::string_view text)
+    {
+        std::ptrdiff_t needed = static_cast<std::ptrdiff_t>(text.size());
+        std::ptrdiff_t front_space = buffer.origin + buffer.first;
+
+        if (front_space < needed)
+        {
+            std::ptrdiff_t used = buffer.last - buffer.first;
+            std::ptrdiff_t grow = std::max(needed - front_space, used + needed);
+            buffer.data.insert(0, static_cast<std::size_t>(grow), '\0');
+            buffer.origin += grow;
+        }
+
+        buffer.first -= needed;
+        buffer.data.replace(static_cast<std::size_t>(buffer.origin + buffer.first), text.size(), text.data(), text.size());
+    }
+
+public:
+    static bool growInPlace; // whether Conc may add characters to a buffer shared with other strings
+
+    // empty string
+    RpalString() = default;
+
+    explicit RpalString(std::string text)
+    {
+        if (!text.empty())
+        {
+            size = text.size();
+            buffer = std::make_shared<Buffer>();
+            buffer->last = static_cast<std::ptrdiff_t>(size);
+            buffer->data = std::move(text);
+        }
+    }
+
+    std::size_t length() const
+    {
+        return size;
+    }
+
+    bool empty() const
+    {
+        return size == 0;
+    }
+
+    // characters of the string, valid until the next Conc that grows the same buffer at the front
+    std::string_view view() const
+    {
+        if (buffer == nullptr)
+        {
+            return {};
+        }
+
+        return std::string_view(buffer->data).substr(static_cast<std::size_t>(buffer->origin + offset), size);
+    }
+
+    std::string str() const
+    {
+        return std::string(view());
+    }
+
+    bool operator==(const RpalString &other) const
+    {
+        return size == other.size && view() == other.view();
+    }
+
+    bool operator!=(const RpalString &other) const
+    {
+        return !(*this == other);
+    }
+
+    // first character of the string, the empty string for an empty string
+    RpalString stem() const
+    {
+        return RpalString(buffer, offset, size == 0 ? 0 : 1);
+    }
+
+    // all but the first character of the string
+    RpalString stern() const
+    {
+        if (size == 0)
+        {
+            throw std::runtime_error("Invalid argument for Stern: empty string");
+        }
+
+        return RpalString(buffer, offset + 1, size - 1);
+    }
+
+    // concatenation of the string and the given string
+    RpalString concat(const RpalString &other) const
+    {
+        if (other.empty())
+        {
+            return *this;
+        }
+        if (empty())
+        {
+            return other;
+        }
+
+        // when both strings share the buffer, the characters are copied out before the buffer grows
+        bool shared = buffer == other.buffer;
+
+        if (growInPlace && ends_buffer())
+        {
+            append_to(*buffer, shared ? std::string_view(other.str()) : other.view());
+            return RpalString(buffer, offset, size + other.size);
+        }
+
+        if (growInPlace && other.starts_buffer())
+        {
+            prepend_to(*other.buffer, shared ? std::string_view(str()) : view());
+            return RpalString(other.buffer, other.offset - static_cast<std::ptrdiff_t>(size), size + other.size);
+        }
+
+        std::string text;
+        text.reserve(size + other.size);
+        text.append(view());
+        text.append(other.view());
+        return RpalString(std::move(text));
+    }
+};
+
+bool RpalString::growInPlace = true;
+
+#endif // RPAL_STRING_H
@@ -0,0 +1,162 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work stealing thread pool for the experimental parallel evaluation.
+ * Every worker has its own queue of tasks: it takes the task it added last, and when its queue is empty it steals
+ * the oldest task of another queue. Threads that are not workers, such as the main thread, share one more queue.
+ * A thread waiting for its tasks keeps running tasks instead of blocking, so tasks can wait for tasks they add.
+ */
+class TaskPool
+{
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues; // one for each worker, the last one for the other threads
+    std::vector<std::thread> workers;
+    std::atomic<int> queued{0}; // tasks added and not started yet
+    std::atomic<bool> stopping{false};
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+
+    static thread_local int currentQueue; // queue of the running thread, -1 for threads that are not workers
+
+    // TaskPool is not copyable
+    TaskPool(const TaskPool &) = delete;
+    TaskPool &operator=(const TaskPool &) = delete;
+
+    int own_queue() const
+    {
+        return currentQueue >= 0 ? currentQueue : static_cast<int>(queues.size()) - 1;
+    }
+
+    // run one task, the newest of the own queue or the oldest of another queue
+    bool run_one()
+    {
+        int own = own_queue();
+        std::function<void()> task;
+
+        for (std::size_t i = 0; i < queues.size() && !task; i++)
+        {
+            Queue &queue = *queues[(own + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+
+            if (!queue.tasks.empty())
+            {
+                if (i == 0)
+                {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                }
+                else
+                {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+            }
+        }
+
+        if (!task)
+        {
+            return false;
+        }
+
+        queued--;
+        task();
+        return true;
+    }
+
+    void work(int queue)
+    {
+        currentQueue = queue;
+
+        while (!stopping)
+        {
+            if (!run_one())
+            {
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                wakeUp.wait_for(lock, std::chrono::milliseconds(1), [this] { return stopping || queued > 0; });
+            }
+        }
+    }
+
+public:
+    /**
+     * Starts the workers.
+     * @param threads The number of threads running tasks, including the thread that adds the first tasks.
+     */
+    explicit TaskPool(unsigned threads)
+    {
+        unsigned workerCount = threads > 1 ? threads - 1 : 0;
+
+        for (unsigned i = 0; i <= workerCount; i++)
+        {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (unsigned i = 0; i < workerCount; i++)
+        {
+            workers.emplace_back(&TaskPool::work, this, static_cast<int>(i));
+        }
+    }
+
+    ~TaskPool()
+    {
+        stopping = true;
+        wakeUp.notify_all();
+
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    // whether there are more tasks waiting than workers to take them, new work is better done in place then
+    bool saturated() const
+    {
+        return queued >= static_cast<int>(workers.size());
+    }
+
+    // add a task to the queue of the running thread
+    void submit(std::function<void()> task)
+    {
+        {
+            Queue &queue = *queues[own_queue()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        queued++;
+        wakeUp.notify_one();
+    }
+
+    // run tasks until the count of unfinished tasks drops to zero
+    void wait(const std::atomic<int> &pending)
+    {
+        while (pending > 0)
+        {
+            if (!run_one())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+thread_local int TaskPool::currentQueue = -1;
+
+#endif // TASK_POOL_H
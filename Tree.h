@@ -3,7 +3,10 @@
 
 #include "TreeNode.h"
 
+#include <stdexcept>
+
 void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode);
+CustomTreeNode *standardizeNode(CustomTreeNode *currentNode);
 
 /**
  * @brief Represents the Custom Tree for a program.
@@ -122,24 +125,73 @@ CustomTree *CustomTree::customTree = new CustomTree(); // Initialize the singlet
 
 /**
  * Generates the Syntax CustomTree (ST) by modifying the given customTree structure.
+ * Children are standardized before their parent. Nodes waiting for their children are kept on an
+ * explicit stack, so deeply nested programs do not exhaust the C++ stack.
  */
 void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode = nullptr)
 {
     if (currentNode == nullptr)
     {
-        return; 
+        return;
     }
 
-    if (currentNode->getChildCount() != 0)
+    struct PendingNode
     {
-        std::vector<CustomTreeNode *> children = currentNode->getChildren(); // Get the children of the current node
-        for (CustomTreeNode *child : children)
+        CustomTreeNode *node;   // The node to standardize
+        CustomTreeNode *parent; // The parent the standardized node is written back into
+        size_t childIndex;      // The position of the node among the children of the parent
+        bool childrenPushed;    // Whether the children of the node are already on the stack
+    };
+
+    std::vector<PendingNode> pendingNodes = {{currentNode, parentNode, 0, false}};
+
+    while (!pendingNodes.empty())
+    {
+        if (!pendingNodes.back().childrenPushed)
         {
-            generateSyntaxTree(child, currentNode); // Recursively generate the syntax customTree for each child
-            currentNode->removeChild(0);    // Remove the processed child from the current node
+            pendingNodes.back().childrenPushed = true;
+            CustomTreeNode *node = pendingNodes.back().node;
+
+            // Push the children in reverse so that they are standardized in order
+            std::vector<CustomTreeNode *> &children = node->getChildren();
+            for (size_t i = children.size(); i-- > 0;)
+            {
+                pendingNodes.push_back({children[i], node, i, false});
+            }
+            continue;
+        }
+
+        PendingNode pending = pendingNodes.back();
+        pendingNodes.pop_back();
+
+        CustomTreeNode *root_node = standardizeNode(pending.node);
+
+        if (pending.parent == nullptr)
+        {
+            // If the parentNode is null, set the root_node as the new syntax customTree root
+            CustomTree::getInstance().setSTRoot(root_node);
+        }
+        else
+        {
+            // Replace the processed child in its own slot, so each node costs constant time
+            pending.parent->getChildren()[pending.childIndex] = root_node;
+        }
+
+        if (root_node != pending.node)
+        {
+            // If the root_node and currentNode are different, it means the currentNode was replaced
+            delete pending.node; // Delete the old currentNode to free memory
         }
     }
+}
 
+/**
+ * Applies the standardizing rule of a node whose children are already standardized.
+ * @param currentNode The node to standardize.
+ * @return The node that replaces currentNode in the Standardized CustomTree (ST).
+ */
+CustomTreeNode *standardizeNode(CustomTreeNode *currentNode)
+{
     CustomTreeNode *root_node; // Assign the current node as the root node of the syntax customTree
 
     // Define a static vector of binary operators
@@ -150,7 +202,7 @@ void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode
     {   // Process "let" nodes
         if (currentNode->getChildCount() == 2)
         {
-            std::vector<CustomTreeNode *> children = currentNode->getChildren();
+            const std::vector<CustomTreeNode *> &children = currentNode->getChildren();
 
             CustomTreeNode *eq_node;
             CustomTreeNode *p_node;
@@ -187,6 +239,8 @@ void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode
                 gamma_node->appendChild(lambda_node);
                 gamma_node->appendChild(expr_node);
 
+                CustomTreeNode::deleteDetachedNode(eq_node); // Its children are moved to the new nodes
+
                 root_node = gamma_node; // Assign the gamma_node as the new root node
                                         //            parentNode->appendChild(gamma_node);
             }
@@ -204,7 +258,7 @@ void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode
     {
         if (currentNode->getChildCount() == 2)
         {
-            std::vector<CustomTreeNode *> children = currentNode->getChildren();
+            const std::vector<CustomTreeNode *> &children = currentNode->getChildren();
 
             CustomTreeNode *eq_node;
             CustomTreeNode *p_node;
@@ -241,6 +295,8 @@ void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode
                 gamma_node->appendChild(lambda_node);
                 gamma_node->appendChild(expr_node);
 
+                CustomTreeNode::deleteDetachedNode(eq_node); // Its children are moved to the new nodes
+
                 root_node = gamma_node; // Assign the gamma_node as the new root node
                                         //            parentNode->appendChild(gamma_node);
             }
@@ -258,25 +314,22 @@ void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode
     {
         if (currentNode->getChildCount() > 2)
         {
-            std::vector<CustomTreeNode *> children = currentNode->getChildren();
+            const std::vector<CustomTreeNode *> &children = currentNode->getChildren();
 
+            // The first child is the function name and the last one is the body;
+            // everything in between is a parameter
             CustomTreeNode *fcn_name_node = children.front();
-            // Remove fcn_name_node from children
-            children.erase(children.begin());
-
             CustomTreeNode *expr_node = children.back();
-            // Remove expr_node from children
-            children.pop_back();
 
             CustomTreeNode *eq_node = new InternalNode("=");
 
             eq_node->appendChild(fcn_name_node);
 
             CustomTreeNode *prev_node = eq_node;
-            for (CustomTreeNode *child : children)
+            for (size_t i = 1; i + 1 < children.size(); i++)
             {
                 CustomTreeNode *lambda_node = new InternalNode("lambda");
-                lambda_node->appendChild(child);
+                lambda_node->appendChild(children[i]);
                 prev_node->appendChild(lambda_node);
                 prev_node = lambda_node;
             }
@@ -302,29 +355,28 @@ void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode
     {
         if (currentNode->getChildCount() >= 2)
         {
-            std::vector<CustomTreeNode *> children = currentNode->getChildren();
+            const std::vector<CustomTreeNode *> &children = currentNode->getChildren();
 
+            // The last child is the body; every other child gets a lambda of its own
             CustomTreeNode *expr_node = children.back();
-            // Remove expr_node from children
-            children.pop_back();
-
-            CustomTreeNode *head_lambda_node = new InternalNode("lambda");
 
-            CustomTreeNode *prev_node = head_lambda_node;
-            for (CustomTreeNode *child : children)
+            CustomTreeNode *prev_node = nullptr;
+            for (size_t i = 0; i + 1 < children.size(); i++)
             {
                 CustomTreeNode *lambda_node = new InternalNode("lambda");
-                lambda_node->appendChild(child);
-                prev_node->appendChild(lambda_node);
+                lambda_node->appendChild(children[i]);
+                if (prev_node == nullptr)
+                {
+                    root_node = lambda_node;
+                }
+                else
+                {
+                    prev_node->appendChild(lambda_node);
+                }
                 prev_node = lambda_node;
             }
 
             prev_node->appendChild(expr_node);
-
-            root_node = head_lambda_node->getChildren()[0];
-            head_lambda_node->getChildren().erase(head_lambda_node->getChildren().begin());
-            delete head_lambda_node;
-            //        parentNode->appendChild(head_lambda_node);
         }
         else
         {
@@ -335,7 +387,7 @@ void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode
     {
         if (currentNode->getChildCount() == 2)
         {
-            std::vector<CustomTreeNode *> children = currentNode->getChildren();
+            const std::vector<CustomTreeNode *> &children = currentNode->getChildren();
 
             // Check if each child is the "=" node and has exactly 2 children
             for (CustomTreeNode *child : children)
@@ -371,6 +423,10 @@ void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode
             new_lambda_node->appendChild(first_eq_node->getChildren()[0]);
             new_lambda_node->appendChild(second_eq_node->getChildren()[1]);
 
+            // Their children are moved to the new nodes
+            CustomTreeNode::deleteDetachedNode(first_eq_node);
+            CustomTreeNode::deleteDetachedNode(second_eq_node);
+
             root_node = new_eq_node; // Assign the new_eq_node as the new root node
                                      //        parentNode->appendChild(new_eq_node);
         }
@@ -395,7 +451,7 @@ void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode
     {
         if (currentNode->getChildCount() == 3)
         {
-            std::vector<CustomTreeNode *> children = currentNode->getChildren();
+            const std::vector<CustomTreeNode *> &children = currentNode->getChildren();
 
             CustomTreeNode *first_gamma_node = new InternalNode("gamma");
             CustomTreeNode *second_gamma_node = new InternalNode("gamma");
@@ -420,7 +476,7 @@ void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode
     {
         if (currentNode->getChildCount() >= 2)
         {
-            std::vector<CustomTreeNode *> children = currentNode->getChildren();
+            const std::vector<CustomTreeNode *> &children = currentNode->getChildren();
 
             CustomTreeNode *eq_node = new InternalNode("=");
             CustomTreeNode *comma_node = new InternalNode(",");
@@ -430,11 +486,15 @@ void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode
             eq_node->appendChild(comma_node);
             eq_node->appendChild(tau_node);
 
+            comma_node->getChildren().reserve(children.size());
+            tau_node->getChildren().reserve(children.size());
+
             // Iterate through the children and modify comma_node and tau_node
             for (CustomTreeNode *child : children)
             {
                 comma_node->appendChild(child->getChildren()[0]);
                 tau_node->appendChild(child->getChildren()[1]);
+                CustomTreeNode::deleteDetachedNode(child); // Its children are moved to the new nodes
             }
 
             root_node = eq_node; // Assign the eq_node as the new root node
@@ -469,12 +529,27 @@ void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode
             new_gamma_node->appendChild(y_str_node);
             new_gamma_node->appendChild(new_lambda_node);
 
-            new_lambda_node->appendChild(var_node);
+            // The lambda gets its own copy of the variable, so that every ST node has a single parent
+            CustomTreeNode *lambda_var_node;
+            if (var_node->getLabel() == ",")
+            {
+                lambda_var_node = new InternalNode(",");
+                for (CustomTreeNode *child : var_node->getChildren())
+                {
+                    lambda_var_node->appendChild(new LeafNode(child->getLabel(), child->getValue()));
+                }
+            }
+            else
+            {
+                lambda_var_node = new LeafNode(var_node->getLabel(), var_node->getValue());
+            }
+
+            new_lambda_node->appendChild(lambda_var_node);
             new_lambda_node->appendChild(expr_node);
 
             new_eq_node->appendChild(new_gamma_node);
 
-            delete eq_node;
+            CustomTreeNode::deleteDetachedNode(eq_node);
 
             root_node = new_eq_node;
             //        parentNode->appendChild(currentNode);
@@ -489,23 +564,274 @@ void generateSyntaxTree(CustomTreeNode *currentNode, CustomTreeNode *parentNode
         root_node = currentNode;
         //        parentNode->appendChild(currentNode);
     }
-    if (parentNode == nullptr)
+    return root_node;
+}
+
+/**
+ * @brief A node of the Standardized CustomTree (ST) as seen by the control structure builder.
+ *
+ * A StandardizedNode either wraps an existing ST node, or stands for the node the standardizing
+ * rules would build from an AST node. The latter lets the control structures be built straight
+ * from the AST in one pass: the let, where, fcn_form, lambda, within, and, rec and @ rules are
+ * applied while the nodes are visited and no ST node is allocated.
+ */
+class StandardizedNode
+{
+private:
+    enum class Form
     {
-        // If the parentNode is null, set the root_node as the new syntax customTree root
-        CustomTree::getInstance().setSTRoot(root_node);
-        return; // Exit the function
+        ST,            // An existing ST node
+        AST,           // An AST node, standardized on the fly
+        LET_LAMBDA,    // lambda X P of let (= X E) P
+        WHERE_LAMBDA,  // lambda X P of P where (= X E)
+        AT_INNER,      // gamma N E1 of @ E1 N E2
+        LAMBDA_CHAIN,  // lambda V_i (lambda V_i+1 ... E) of a lambda or fcn_form node
+        WITHIN_GAMMA,  // gamma (lambda X1 E2) E1 of (= X1 E1) within (= X2 E2)
+        WITHIN_LAMBDA, // lambda X1 E2 of (= X1 E1) within (= X2 E2)
+        AND_TAU,       // tau E1 ... En of (= X1 E1) and ... (= Xn En)
+        AND_BINDER,    // , X1 ... Xn of (= X1 E1) and ... (= Xn En)
+        REC_GAMMA,     // gamma Y* (lambda X E) of rec (= X E)
+        REC_LAMBDA,    // lambda X E of rec (= X E)
+        Y_STAR         // the Y* identifier of rec
+    };
+
+    Form form;
+    CustomTreeNode *node;
+    int index; // The position of the bound variable in a LAMBDA_CHAIN
+
+    StandardizedNode(Form form, CustomTreeNode *node, int index = 0) : form(form), node(node), index(index) {}
+
+    // The variable (or variable list) a definition binds once standardized to = X E
+    static StandardizedNode binder(CustomTreeNode *definition)
+    {
+        while (definition->getLabel() == "within" || definition->getLabel() == "rec")
+        {
+            definition = definition->getLabel() == "within" ? definition->getChildren()[1] : definition->getChildren()[0];
+        }
+
+        if (definition->getLabel() == "and")
+        {
+            return {Form::AND_BINDER, definition};
+        }
+        if (definition->getLabel() == "=" || definition->getLabel() == "fcn_form")
+        {
+            return {Form::AST, definition->getChildren()[0]};
+        }
+
+        throw std::runtime_error("Error: " + definition->getLabel() + " node is not a definition");
     }
-    else
+
+    // The expression a definition binds once standardized to = X E
+    static StandardizedNode definitionValue(CustomTreeNode *definition)
     {
-        // If the parentNode is not null, add the root_node as a child of the parentNode
-        parentNode->appendChild(root_node);
+        const std::string label = definition->getLabel();
+
+        if (label == "=")
+        {
+            return {Form::AST, definition->getChildren()[1]};
+        }
+        if (label == "fcn_form")
+        {
+            return {Form::LAMBDA_CHAIN, definition, 1};
+        }
+        if (label == "within")
+        {
+            return {Form::WITHIN_GAMMA, definition};
+        }
+        if (label == "and")
+        {
+            return {Form::AND_TAU, definition};
+        }
+        if (label == "rec")
+        {
+            return {Form::REC_GAMMA, definition};
+        }
+
+        throw std::runtime_error("Error: " + label + " node is not a definition");
     }
 
-    if (root_node != currentNode)
+    // Whether an AST lambda node is rewritten into a chain of single variable lambdas
+    static bool isLambdaChain(CustomTreeNode *lambda)
     {
-        // If the root_node and currentNode are different, it means the currentNode was replaced
-        delete currentNode; // Delete the old currentNode to free memory
+        return lambda->getChildren()[0]->getLabel() != "," && lambda->getChildren()[1]->getLabel() != ",";
     }
-}
+
+public:
+    /**
+     * @brief Wraps a node of an already standardized tree.
+     * @param root The ST node.
+     */
+    static StandardizedNode of(CustomTreeNode *root)
+    {
+        return {Form::ST, root};
+    }
+
+    /**
+     * @brief Views an AST node as the ST node it standardizes to.
+     * @param root The AST node.
+     */
+    static StandardizedNode standardize(CustomTreeNode *root)
+    {
+        return {Form::AST, root};
+    }
+
+    /**
+     * @brief Returns the label of the node in the ST.
+     */
+    const std::string &getLabel() const
+    {
+        static const std::string gamma = "gamma", tau = "tau", comma = ",", identifier = "identifier", lambda = "lambda";
+
+        switch (form)
+        {
+        case Form::ST:
+            return node->getLabel();
+        case Form::AST:
+        {
+            const std::string &label = node->getLabel();
+            if (label == "let" || label == "where" || label == "@")
+            {
+                return gamma;
+            }
+            return label;
+        }
+        case Form::AT_INNER:
+        case Form::WITHIN_GAMMA:
+        case Form::REC_GAMMA:
+            return gamma;
+        case Form::AND_TAU:
+            return tau;
+        case Form::AND_BINDER:
+            return comma;
+        case Form::Y_STAR:
+            return identifier;
+        default:
+            return lambda;
+        }
+    }
+
+    /**
+     * @brief Returns the value of the node in the ST.
+     */
+    const std::string &getValue() const
+    {
+        static const std::string yStar = "Y*", blank = " ";
+
+        switch (form)
+        {
+        case Form::ST:
+        case Form::AST:
+            return node->getValue();
+        case Form::Y_STAR:
+            return yStar;
+        default:
+            return blank;
+        }
+    }
+
+    /**
+     * @brief Returns the number of children of the node in the ST.
+     */
+    int getChildCount() const
+    {
+        switch (form)
+        {
+        case Form::ST:
+            return node->getChildCount();
+        case Form::AST:
+            if (node->getLabel() == "let" || node->getLabel() == "where" || node->getLabel() == "@" ||
+                (node->getLabel() == "lambda" && isLambdaChain(node)))
+            {
+                return 2;
+            }
+            return node->getChildCount();
+        case Form::AND_TAU:
+        case Form::AND_BINDER:
+            return node->getChildCount();
+        case Form::Y_STAR:
+            return 0;
+        default:
+            return 2;
+        }
+    }
+
+    /**
+     * @brief Returns a child of the node in the ST.
+     * @param i The index of the child.
+     */
+    StandardizedNode getChild(int i) const
+    {
+        std::vector<CustomTreeNode *> &children = node->getChildren();
+
+        switch (form)
+        {
+        case Form::ST:
+            return {Form::ST, children[i]};
+
+        case Form::AST:
+        {
+            const std::string label = node->getLabel();
+            if (label == "let")
+            {
+                return i == 0 ? StandardizedNode(Form::LET_LAMBDA, node) : definitionValue(children[0]);
+            }
+            if (label == "where")
+            {
+                return i == 0 ? StandardizedNode(Form::WHERE_LAMBDA, node) : definitionValue(children[1]);
+            }
+            if (label == "@")
+            {
+                return i == 0 ? StandardizedNode(Form::AT_INNER, node) : StandardizedNode(Form::AST, children[2]);
+            }
+            if (label == "lambda" && isLambdaChain(node))
+            {
+                return StandardizedNode(Form::LAMBDA_CHAIN, node, 0).getChild(i);
+            }
+            return {Form::AST, children[i]};
+        }
+
+        case Form::LET_LAMBDA:
+            return i == 0 ? binder(children[0]) : StandardizedNode(Form::AST, children[1]);
+
+        case Form::WHERE_LAMBDA:
+            return i == 0 ? binder(children[1]) : StandardizedNode(Form::AST, children[0]);
+
+        case Form::AT_INNER:
+            return {Form::AST, children[i == 0 ? 1 : 0]};
+
+        case Form::LAMBDA_CHAIN:
+            if (i == 0)
+            {
+                return {Form::AST, children[index]};
+            }
+            if (index + 2 < static_cast<int>(children.size()))
+            {
+                return {Form::LAMBDA_CHAIN, node, index + 1};
+            }
+            return {Form::AST, children.back()};
+
+        case Form::WITHIN_GAMMA:
+            return i == 0 ? StandardizedNode(Form::WITHIN_LAMBDA, node) : definitionValue(children[0]);
+
+        case Form::WITHIN_LAMBDA:
+            return i == 0 ? binder(children[0]) : definitionValue(children[1]);
+
+        case Form::AND_TAU:
+            return definitionValue(children[i]);
+
+        case Form::AND_BINDER:
+            return binder(children[i]);
+
+        case Form::REC_GAMMA:
+            return i == 0 ? StandardizedNode(Form::Y_STAR, node) : StandardizedNode(Form::REC_LAMBDA, node);
+
+        case Form::REC_LAMBDA:
+            return i == 0 ? binder(children[0]) : definitionValue(children[0]);
+
+        default:
+            throw std::out_of_range("Index out of range");
+        }
+    }
+};
 
 #endif // CUSTOM_TREE_H
@@ -59,7 +59,7 @@ public:
      * @brief Returns the labelOfNode of the node.
      * @return The labelOfNode of the node as a string.
      */
-    std::string getLabel() const
+    const std::string &getLabel() const
     {
         return labelOfNode;
     }
@@ -94,7 +94,7 @@ public:
      * @brief Returns the value associated with the node.
      * @return The value of the node as a string.
      */
-    virtual std::string getValue() const
+    virtual const std::string &getValue() const
     {
         return nodeValue;
     }
@@ -110,6 +110,7 @@ public:
 
     /**
      * @brief Releases the memory occupied by a CustomTreeNode and its child nodes.
+     * Nodes still to be released are kept on an explicit stack so that deep trees are handled.
      * @param node The node to release memory for.
      */
     static void deleteNodeMemory(CustomTreeNode *node)
@@ -117,12 +118,30 @@ public:
         if (node == nullptr)
             return;
 
-        for (CustomTreeNode *child : node->getChildren())
+        std::vector<CustomTreeNode *> pendingNodes = {node};
+
+        while (!pendingNodes.empty())
         {
-            deleteNodeMemory(child);
+            CustomTreeNode *current = pendingNodes.back();
+            pendingNodes.pop_back();
+
+            for (CustomTreeNode *child : current->getChildren())
+            {
+                pendingNodes.push_back(child);
+            }
+
+            delete current;
         }
+    }
 
-        delete node;
+    /**
+     * @brief Releases a node whose children have been moved elsewhere in the tree.
+     * @param node The node to release memory for.
+     */
+    static void deleteDetachedNode(CustomTreeNode *node)
+    {
+        node->getChildren().clear();
+        deleteNodeMemory(node);
     }
 };
 
@@ -0,0 +1,720 @@
+#ifndef TYPE_INFERENCE_H
+#define TYPE_INFERENCE_H
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "Tree.h"
+#include "CSE.h"
+
+/**
+ * @brief Hindley-Milner type inference over the Standardized CustomTree (ST).
+ *
+ * Runs between CustomTree::generate() (and the Optimizer) and CSE::create_cs() when the interpreter is
+ * started with -types. Types are integers, strings, truth values, functions and tuples whose elements
+ * all have one type, and the names bound by let are polymorphic. Where the types of a program do not
+ * fit, as in a tuple of an integer and a string, the types that meet become dynamic, along with the
+ * types they are made of, instead of failing: the program runs as before and nothing is proven about
+ * the values of a dynamic type.
+ *
+ * Operators whose operands are proven to be integers, and gammas proven to index a tuple with an
+ * integer, are marked with the value "typed". The control structure builder passes the mark on to
+ * their instructions, which then take their integer or tuple form without checking the values.
+ *
+ * The rules follow the evaluator:
+ * - Y* has the type ((a -> b) -> a -> b) -> a -> b, and rec f = fn x. E binds f to the type of its lambda,
+ * - aug takes a tuple and an element of it, nil is a tuple of a new element type wherever it is used,
+ * - arithmetic and ordering take integers, eq and ne take any values and conditions are not typed,
+ *   as the evaluator takes integers for truth values,
+ * - variables are looked up by kind before scope, so a name bound where another binding of the name is
+ *   visible has the type of both,
+ * - Print pushes no value and Conc takes its second argument off the stack, so nothing is proven about
+ *   a program that uses the value of Print or applies Conc to one argument.
+ */
+class TypeInference
+{
+private:
+    enum class Kind
+    {
+        VARIABLE,
+        INTEGER,
+        STRING,
+        BOOLEAN,
+        TUPLE,
+        FUNCTION,
+        DYNAMIC
+    };
+
+    // A type, which stands for the type of its parent once it is unified with another one
+    struct Type
+    {
+        Kind kind;
+        int parent;
+        int first;  // element type of a tuple, argument type of a function
+        int second; // result type of a function
+        int level;  // lets a variable was made in, the variables made in the definition of a let are generalized
+    };
+
+    // The type of a name in scope, the variables of a polymorphic binding deeper than level are copied at every use
+    struct Binding
+    {
+        int type;
+        int level;
+        bool polymorphic;
+    };
+
+    // A step of the walk over the tree, the types of the nodes typed are pushed on results
+    struct Task
+    {
+        enum class Kind
+        {
+            VISIT,       // type the node
+            DEFINE,      // the definition of a let or bind node is typed one level deeper
+            LET,         // bind the variable of a let or bind node to the type of its definition and type the body
+            RELEASE,     // the variables of the binder node go out of scope
+            LAMBDA,      // make the type of a lambda, its body is typed
+            REC,         // unify the name of a rec with its lambda, which is typed
+            APPLY,       // apply the type of a function or index a tuple, both are typed
+            CONDITIONAL, // unify the branches of a conditional
+            TUPLE,       // make the type of a tau or tuple node, its elements are typed
+            OPERATOR     // apply an operator, its operands are typed
+        };
+
+        Kind kind;
+        CustomTreeNode *node;
+        bool tail; // the value of the node is the value of the program
+    };
+
+    // An operator or gamma node, marked if the types of its operands are proven, the tuple first for a gamma
+    struct Site
+    {
+        CustomTreeNode *node;
+        int first;
+        int second; // -1 for neg
+    };
+
+    std::vector<Type> types;
+    int level = 0;
+    std::unordered_map<std::string, std::vector<Binding>> bindings;
+    std::vector<Task> tasks;
+    std::vector<int> results;
+    std::vector<Site> sites;
+    std::unordered_set<const CustomTreeNode *> allowedBuiltins; // Print applied in tail position and Conc applied twice
+    bool sound = true; // false when the program uses Print or Conc in a way that moves values on the stack
+
+    TypeInference() = default;
+
+    int make(Kind kind, int first = -1, int second = -1)
+    {
+        int type = static_cast<int>(types.size());
+        types.push_back({kind, type, first, second, level});
+        return type;
+    }
+
+    int variable()
+    {
+        return make(Kind::VARIABLE);
+    }
+
+    int tuple(int element)
+    {
+        return make(Kind::TUPLE, element);
+    }
+
+    int function(int argument, int result)
+    {
+        return make(Kind::FUNCTION, argument, result);
+    }
+
+    int find(int type)
+    {
+        int root = type;
+        while (types[root].parent != root)
+        {
+            root = types[root].parent;
+        }
+        while (types[type].parent != root)
+        {
+            int next = types[type].parent;
+            types[type].parent = root;
+            type = next;
+        }
+        return root;
+    }
+
+    // Makes a type and the types it is made of dynamic
+    void makeDynamic(int type)
+    {
+        std::vector<int> pending = {type};
+
+        while (!pending.empty())
+        {
+            Type &made = types[find(pending.back())];
+            pending.pop_back();
+
+            if (made.kind == Kind::TUPLE || made.kind == Kind::FUNCTION)
+            {
+                pending.push_back(made.first);
+            }
+            if (made.kind == Kind::FUNCTION)
+            {
+                pending.push_back(made.second);
+            }
+            made.kind = Kind::DYNAMIC;
+        }
+    }
+
+    // Lowers the level of the variables of a type to the level of a variable bound to it, false if the variable occurs in it
+    bool lowerLevels(int variable, int type)
+    {
+        std::vector<int> pending = {type};
+        std::unordered_set<int> seen;
+
+        while (!pending.empty())
+        {
+            int current = find(pending.back());
+            pending.pop_back();
+
+            if (current == variable)
+            {
+                return false;
+            }
+            if (!seen.insert(current).second)
+            {
+                continue;
+            }
+
+            Type &made = types[current];
+            if (made.kind == Kind::VARIABLE)
+            {
+                made.level = std::min(made.level, types[variable].level);
+            }
+            if (made.kind == Kind::TUPLE || made.kind == Kind::FUNCTION)
+            {
+                pending.push_back(made.first);
+            }
+            if (made.kind == Kind::FUNCTION)
+            {
+                pending.push_back(made.second);
+            }
+        }
+        return true;
+    }
+
+    // Unifies two types, types that do not fit become dynamic
+    void unify(int first, int second)
+    {
+        std::vector<std::pair<int, int>> pending = {{first, second}};
+
+        while (!pending.empty())
+        {
+            int a = find(pending.back().first);
+            int b = find(pending.back().second);
+            pending.pop_back();
+
+            if (a == b)
+            {
+                continue;
+            }
+            if (types[a].kind == Kind::VARIABLE)
+            {
+                std::swap(a, b);
+            }
+
+            if (types[b].kind == Kind::VARIABLE)
+            {
+                if (types[a].kind == Kind::VARIABLE)
+                {
+                    types[a].level = std::min(types[a].level, types[b].level);
+                }
+                else if (!lowerLevels(b, a))
+                {
+                    // a recursive type, such as the type of a function applied to itself
+                    makeDynamic(a);
+                }
+                types[b].parent = a;
+            }
+            else if (types[a].kind == types[b].kind && types[a].kind != Kind::DYNAMIC)
+            {
+                types[a].parent = b;
+                if (types[a].kind == Kind::TUPLE || types[a].kind == Kind::FUNCTION)
+                {
+                    pending.emplace_back(types[a].first, types[b].first);
+                }
+                if (types[a].kind == Kind::FUNCTION)
+                {
+                    pending.emplace_back(types[a].second, types[b].second);
+                }
+            }
+            else
+            {
+                makeDynamic(a);
+                makeDynamic(b);
+                types[a].parent = b;
+            }
+        }
+    }
+
+    // A copy of the type of a polymorphic binding, with new variables for the ones made deeper than the binding
+    int instantiate(int type, int bindingLevel)
+    {
+        std::unordered_map<int, int> copies;
+        std::vector<std::pair<int, bool>> pending = {{find(type), false}};
+
+        while (!pending.empty())
+        {
+            int current = pending.back().first;
+            bool expanded = pending.back().second;
+
+            if (copies.count(current) != 0)
+            {
+                pending.pop_back();
+                continue;
+            }
+
+            Kind kind = types[current].kind;
+            if (kind != Kind::TUPLE && kind != Kind::FUNCTION)
+            {
+                pending.pop_back();
+                bool generic = kind == Kind::VARIABLE && types[current].level > bindingLevel;
+                copies[current] = generic ? variable() : current;
+                continue;
+            }
+
+            int first = find(types[current].first);
+            int second = kind == Kind::FUNCTION ? find(types[current].second) : -1;
+
+            if (!expanded)
+            {
+                pending.back().second = true;
+                pending.emplace_back(first, false);
+                if (second >= 0)
+                {
+                    pending.emplace_back(second, false);
+                }
+                continue;
+            }
+
+            pending.pop_back();
+            int firstCopy = copies.at(first);
+            int secondCopy = second >= 0 ? copies.at(second) : -1;
+
+            // the parts without generic variables are shared, so they stay unified with every use
+            copies[current] = firstCopy == first && secondCopy == second ? current : make(kind, firstCopy, secondCopy);
+        }
+
+        return copies.at(find(type));
+    }
+
+    // The type of a built-in function, or of nil, at a use of it
+    int builtinType(const std::string &name)
+    {
+        if (name == "Print" || name == "print")
+        {
+            return function(variable(), make(Kind::DYNAMIC));
+        }
+        if (name == "Order")
+        {
+            return function(tuple(variable()), make(Kind::INTEGER));
+        }
+        if (name == "Isempty")
+        {
+            return function(tuple(variable()), make(Kind::BOOLEAN));
+        }
+        if (name == "Isinteger" || name == "Isstring" || name == "Istuple")
+        {
+            return function(variable(), make(Kind::BOOLEAN));
+        }
+        if (name == "Conc")
+        {
+            // the second argument may also be an integer
+            return function(make(Kind::STRING), function(variable(), make(Kind::STRING)));
+        }
+        if (name == "Stem" || name == "Stern")
+        {
+            return function(make(Kind::STRING), make(Kind::STRING));
+        }
+        if (name == "ItoS")
+        {
+            return function(make(Kind::INTEGER), make(Kind::STRING));
+        }
+        if (name == "Y*")
+        {
+            // Y* F is an eta closure, which is only a fixpoint of F when it is applied
+            int argument = variable();
+            int result = variable();
+            return function(function(function(argument, result), function(argument, result)), function(argument, result));
+        }
+        if (name == "nil")
+        {
+            return tuple(variable());
+        }
+        if (name == "dummy")
+        {
+            return make(Kind::DYNAMIC);
+        }
+
+        // the evaluator fails on names that are not bound, so they have no values
+        return variable();
+    }
+
+    // Binds a name to a type, a name bound where another binding of it is visible takes the type of both
+    void bind(const std::string &name, int type, bool polymorphic)
+    {
+        std::vector<Binding> &scope = bindings[name];
+
+        if (!scope.empty())
+        {
+            const Binding &visible = scope.back();
+            unify(type, visible.polymorphic ? instantiate(visible.type, visible.level) : visible.type);
+            polymorphic = false;
+        }
+        scope.push_back({type, level, polymorphic});
+    }
+
+    // Binds the variables of a lambda to the type of its argument
+    void bindParameters(CustomTreeNode *binder, int type)
+    {
+        if (binder->getLabel() != ",")
+        {
+            bind(binder->getValue(), type, false);
+            return;
+        }
+
+        int element = variable();
+        unify(type, tuple(element));
+        for (CustomTreeNode *name : binder->getChildren())
+        {
+            bind(name->getValue(), element, false);
+        }
+    }
+
+    void release(CustomTreeNode *binder)
+    {
+        if (binder->getLabel() != ",")
+        {
+            bindings[binder->getValue()].pop_back();
+            return;
+        }
+
+        for (CustomTreeNode *name : binder->getChildren())
+        {
+            bindings[name->getValue()].pop_back();
+        }
+    }
+
+    int pop()
+    {
+        int type = results.back();
+        results.pop_back();
+        return type;
+    }
+
+    void identifier(const CustomTreeNode *node)
+    {
+        const std::string &name = node->getValue();
+        auto binding = bindings.find(name);
+
+        if (binding != bindings.end() && !binding->second.empty())
+        {
+            const Binding &visible = binding->second.back();
+            results.push_back(visible.polymorphic ? instantiate(visible.type, visible.level) : visible.type);
+            return;
+        }
+
+        if ((name == "Print" || name == "print" || name == "Conc") && allowedBuiltins.count(node) == 0)
+        {
+            sound = false;
+        }
+        results.push_back(builtinType(name));
+    }
+
+    void visit(const Task &task)
+    {
+        CustomTreeNode *node = task.node;
+        const std::string label = node->getLabel();
+        std::vector<CustomTreeNode *> &children = node->getChildren();
+
+        if (label == "integer")
+        {
+            results.push_back(make(Kind::INTEGER));
+        }
+        else if (label == "string")
+        {
+            results.push_back(make(Kind::STRING));
+        }
+        else if (label == "true" || label == "false")
+        {
+            results.push_back(make(Kind::BOOLEAN));
+        }
+        else if (label == "identifier")
+        {
+            identifier(node);
+        }
+        else if (label == "lambda")
+        {
+            int argument = variable();
+            bindParameters(children[0], argument);
+            results.push_back(argument);
+
+            tasks.push_back({Task::Kind::LAMBDA, node, false});
+            tasks.push_back({Task::Kind::VISIT, children[1], false});
+        }
+        else if (label == "gamma" && is_recursive_binding(StandardizedNode::of(node)))
+        {
+            CustomTreeNode *recLambda = children[1];
+            int self = variable();
+            bind(recLambda->getChildren()[0]->getValue(), self, false);
+            results.push_back(self);
+
+            tasks.push_back({Task::Kind::REC, node, false});
+            tasks.push_back({Task::Kind::VISIT, recLambda->getChildren()[1], false});
+        }
+        else if ((label == "gamma" && children[0]->getLabel() == "lambda" &&
+                  children[0]->getChildren()[0]->getLabel() != ",") ||
+                 label == "bind")
+        {
+            // let X = E in B, E is typed one level deeper so that its variables can be generalized
+            CustomTreeNode *definition = children[1];
+
+            tasks.push_back({Task::Kind::LET, node, task.tail});
+            tasks.push_back({Task::Kind::VISIT, definition, false});
+            tasks.push_back({Task::Kind::DEFINE, node, false});
+        }
+        else if (label == "gamma")
+        {
+            CustomTreeNode *rator = children[0];
+
+            if (task.tail && rator->getLabel() == "identifier")
+            {
+                allowedBuiltins.insert(rator);
+            }
+            if (rator->getLabel() == "gamma" && rator->getChildren()[0]->getLabel() == "identifier" &&
+                rator->getChildren()[0]->getValue() == "Conc")
+            {
+                allowedBuiltins.insert(rator->getChildren()[0]);
+            }
+
+            tasks.push_back({Task::Kind::APPLY, node, false});
+            tasks.push_back({Task::Kind::VISIT, children[1], false});
+            tasks.push_back({Task::Kind::VISIT, rator, false});
+        }
+        else if (label == "->")
+        {
+            tasks.push_back({Task::Kind::CONDITIONAL, node, false});
+            tasks.push_back({Task::Kind::VISIT, children[2], task.tail});
+            tasks.push_back({Task::Kind::VISIT, children[1], task.tail});
+            tasks.push_back({Task::Kind::VISIT, children[0], false});
+        }
+        else if (label == "tau" || label == "tuple" || is_operator(label))
+        {
+            tasks.push_back({is_operator(label) ? Task::Kind::OPERATOR : Task::Kind::TUPLE, node, false});
+            for (auto child = children.rbegin(); child != children.rend(); ++child)
+            {
+                tasks.push_back({Task::Kind::VISIT, *child, false});
+            }
+        }
+        else
+        {
+            results.push_back(variable());
+        }
+    }
+
+    void let(const Task &task)
+    {
+        CustomTreeNode *node = task.node;
+        bool isBind = node->getLabel() == "bind";
+        CustomTreeNode *binder = isBind ? node->getChildren()[0] : node->getChildren()[0]->getChildren()[0];
+        CustomTreeNode *body = isBind ? node->getChildren()[2] : node->getChildren()[0]->getChildren()[1];
+
+        level--;
+        bind(binder->getValue(), pop(), true);
+
+        tasks.push_back({Task::Kind::RELEASE, binder, false});
+        tasks.push_back({Task::Kind::VISIT, body, task.tail});
+    }
+
+    void apply(CustomTreeNode *node)
+    {
+        int argument = pop();
+        int rator = pop();
+        int result;
+
+        if (types[find(rator)].kind == Kind::TUPLE)
+        {
+            unify(argument, make(Kind::INTEGER));
+            result = types[find(rator)].first;
+        }
+        else
+        {
+            result = variable();
+            unify(rator, function(argument, result));
+        }
+
+        sites.push_back({node, rator, argument});
+        results.push_back(result);
+    }
+
+    void applyOperator(CustomTreeNode *node)
+    {
+        const std::string label = node->getLabel();
+
+        if (label == "neg")
+        {
+            int operand = pop();
+            unify(operand, make(Kind::INTEGER));
+            sites.push_back({node, operand, -1});
+            results.push_back(make(Kind::INTEGER));
+            return;
+        }
+        if (label == "not")
+        {
+            pop();
+            results.push_back(make(Kind::BOOLEAN));
+            return;
+        }
+
+        int second = pop();
+        int first = pop();
+
+        if (label == "aug")
+        {
+            int augmented = tuple(variable());
+            unify(first, augmented);
+            unify(second, types[augmented].first);
+            results.push_back(augmented);
+        }
+        else if (label == "or" || label == "&")
+        {
+            results.push_back(make(Kind::BOOLEAN));
+        }
+        else if (label == "eq" || label == "ne")
+        {
+            sites.push_back({node, first, second});
+            results.push_back(make(Kind::BOOLEAN));
+        }
+        else
+        {
+            unify(first, make(Kind::INTEGER));
+            unify(second, make(Kind::INTEGER));
+            if (label != "**")
+            {
+                sites.push_back({node, first, second});
+            }
+            bool comparison = label == "ls" || label == "le" || label == "gr" || label == "ge";
+            results.push_back(make(comparison ? Kind::BOOLEAN : Kind::INTEGER));
+        }
+    }
+
+    bool isInteger(int type)
+    {
+        return type < 0 || types[find(type)].kind == Kind::INTEGER;
+    }
+
+    // Marks the operators and gammas whose operands are proven
+    void markProvenSites()
+    {
+        if (!sound)
+        {
+            return;
+        }
+
+        for (const Site &site : sites)
+        {
+            bool proven = site.node->getLabel() == "gamma"
+                              ? types[find(site.first)].kind == Kind::TUPLE && isInteger(site.second)
+                              : isInteger(site.first) && isInteger(site.second);
+            if (proven)
+            {
+                site.node->setValue("typed");
+            }
+        }
+    }
+
+    void run(CustomTreeNode *root)
+    {
+        tasks.push_back({Task::Kind::VISIT, root, true});
+
+        while (!tasks.empty())
+        {
+            Task task = tasks.back();
+            tasks.pop_back();
+
+            switch (task.kind)
+            {
+            case Task::Kind::VISIT:
+                visit(task);
+                break;
+            case Task::Kind::DEFINE:
+                level++;
+                break;
+            case Task::Kind::LET:
+                let(task);
+                break;
+            case Task::Kind::RELEASE:
+                release(task.node);
+                break;
+            case Task::Kind::LAMBDA:
+            {
+                int body = pop();
+                int argument = pop();
+                release(task.node->getChildren()[0]);
+                results.push_back(function(argument, body));
+                break;
+            }
+            case Task::Kind::REC:
+            {
+                int lambda = pop();
+                int self = pop();
+                unify(self, lambda);
+                release(task.node->getChildren()[1]->getChildren()[0]);
+                results.push_back(self);
+                break;
+            }
+            case Task::Kind::APPLY:
+                apply(task.node);
+                break;
+            case Task::Kind::CONDITIONAL:
+            {
+                int otherwise = pop();
+                int then = pop();
+                pop();
+                unify(then, otherwise);
+                results.push_back(then);
+                break;
+            }
+            case Task::Kind::TUPLE:
+            {
+                int element = variable();
+                for (std::size_t i = 0; i < task.node->getChildren().size(); i++)
+                {
+                    unify(pop(), element);
+                }
+                results.push_back(tuple(element));
+                break;
+            }
+            case Task::Kind::OPERATOR:
+                applyOperator(task.node);
+                break;
+            }
+        }
+
+        markProvenSites();
+    }
+
+public:
+    /**
+     * @brief Infers the types of the Standardized CustomTree (ST) and marks the nodes whose operands are proven.
+     */
+    static void infer()
+    {
+        TypeInference inference;
+        inference.run(CustomTree::getInstance().getSTRoot());
+    }
+};
+
+#endif // TYPE_INFERENCE_H
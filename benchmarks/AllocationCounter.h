@@ -0,0 +1,90 @@
+#ifndef BENCHMARK_ALLOCATION_COUNTER_H
+#define BENCHMARK_ALLOCATION_COUNTER_H
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Allocations and bytes allocated with new since the program started
+std::atomic<std::size_t> allocations{0};
+std::atomic<std::size_t> allocatedBytes{0};
+
+// Counts an allocation and takes its memory from malloc, or aligned_alloc for over-aligned types
+void *countedAllocation(std::size_t size, std::size_t alignment = 0)
+{
+    allocations++;
+    allocatedBytes += size;
+
+    size = size > 0 ? size : 1;
+    void *memory = alignment > 0 ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                                 : std::malloc(size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+// Every form of new is replaced, so nothing allocated through the others goes uncounted
+
+void *operator new(std::size_t size)
+{
+    return countedAllocation(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return countedAllocation(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return countedAllocation(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return countedAllocation(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+#endif // BENCHMARK_ALLOCATION_COUNTER_H
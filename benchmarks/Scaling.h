@@ -0,0 +1,69 @@
+#ifndef BENCHMARK_SCALING_H
+#define BENCHMARK_SCALING_H
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+
+// Doubling the size may cost at most this many times more before a benchmark fails
+const double MAX_DOUBLING_RATIO = 3.0;
+
+// Every size is measured this many times and the fastest run is kept
+const int REPETITIONS = 3;
+
+/**
+ * Times a piece of work for a quarter, half and all of the largest size and checks that doubling
+ * the size roughly doubles the time.
+ *
+ * @param name The name printed in front of every measurement.
+ * @param largestSize The largest size measured.
+ * @param run Runs the work for the given size and returns the time it took in milliseconds.
+ * @return Whether the work scaled linearly.
+ */
+bool checkLinearScaling(const std::string &name, int largestSize, const std::function<double(int)> &run)
+{
+    bool linear = true;
+    double previousTime = 0;
+
+    for (int size = largestSize / 4; size <= largestSize; size *= 2)
+    {
+        double bestTime = run(size);
+        for (int i = 1; i < REPETITIONS; i++)
+        {
+            bestTime = std::min(bestTime, run(size));
+        }
+
+        std::cout << name << "\t" << size << "\t" << bestTime << " ms";
+
+        // Very short runs are dominated by noise, so only compare runs above a millisecond
+        if (previousTime > 0 && bestTime > 1.0)
+        {
+            double ratio = bestTime / previousTime;
+            std::cout << "\tx" << ratio;
+            if (ratio > MAX_DOUBLING_RATIO)
+            {
+                std::cout << "  <-- not linear";
+                linear = false;
+            }
+        }
+        std::cout << std::endl;
+
+        previousTime = bestTime;
+    }
+
+    return linear;
+}
+
+// Milliseconds taken by the given work
+double timeMilliseconds(const std::function<void()> &work)
+{
+    auto start = std::chrono::steady_clock::now();
+    work();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+#endif // BENCHMARK_SCALING_H
@@ -0,0 +1,63 @@
+/**
+ * Regression benchmark for aug.
+ *
+ * Evaluates programs that build a tuple one element at a time with aug, the way RPAL programs
+ * collect their results, with integers and with pairs as the elements. The elements are written
+ * after the ones already there instead of being copied, so doubling the number of elements should
+ * roughly double the time.
+ *
+ * Usage: ./aug_bench [largest_size]
+ */
+
+#include <iostream>
+#include <string>
+
+#include "../Parser.h"
+#include "../CSE.h"
+#include "Scaling.h"
+
+// let rec build n t = n eq 0 -> t | build (n - 1) (t aug element) in Order (build size nil)
+std::string augProgram(int size, const std::string &element)
+{
+    return "let rec build n t = n eq 0 -> t | build (n - 1) (t aug " + element + ") in Order (build " +
+           std::to_string(size) + " nil)";
+}
+
+// Milliseconds taken to evaluate the program, the program is parsed before the time starts
+double evaluationMilliseconds(const std::string &program)
+{
+    Lexer lexer(program);
+    TokenStorage::getInstance().setLexer(lexer);
+    Parser::parse();
+    TokenStorage::destroyInstance();
+
+    CustomTreeNode *root = CustomTree::getInstance().getASTRoot();
+    CSE cse;
+    cse.create_cs_fused(root);
+    CustomTreeNode::deleteNodeMemory(root);
+    CustomTree::getInstance().setASTRoot(nullptr);
+
+    return timeMilliseconds([&] { cse.evaluate(); });
+}
+
+int main(int argc, char *argv[])
+{
+    int largestSize = argc > 1 ? std::stoi(argv[1]) : 1000000;
+
+    bool passed = true;
+
+    passed &= checkLinearScaling("aug integer", largestSize, [](int size)
+                                 { return evaluationMilliseconds(augProgram(size, "n")); });
+
+    passed &= checkLinearScaling("aug tuple", largestSize, [](int size)
+                                 { return evaluationMilliseconds(augProgram(size, "(n, n)")); });
+
+    if (!passed)
+    {
+        std::cout << "FAILED: aug does not scale linearly" << std::endl;
+        return 1;
+    }
+
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * Regression benchmark for hidden copies of tuples.
+ *
+ * Counts the bytes allocated while a program indexes a large tuple, binds it to a name, binds
+ * tuples holding it to the variables of a tuple parameter and prints it. Copies of a tuple share
+ * its elements, so doing the work twice as often may allocate a few bytes for the environments and
+ * values of the extra steps, but never anything that grows with the size of the tuple.
+ *
+ * Usage: ./copy_bench [tuple_size]
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../Parser.h"
+#include "../CSE.h"
+#include "AllocationCounter.h"
+
+// Every step is repeated this many times, and then twice as many times
+const int REPETITIONS = 100;
+
+// (1, 2, ..., size)
+std::string tupleText(int size)
+{
+    std::string text = "(1";
+    for (int i = 2; i <= size; i++)
+    {
+        text += ", " + std::to_string(i);
+    }
+    return text + ")";
+}
+
+// let T = (1, ..., size) in loop repetitions 0, where every step of the loop adds the value of step to the sum
+std::string loopProgram(int size, int repetitions, const std::string &step)
+{
+    return "let T = " + tupleText(size) + " in let P = (T, T) in " +
+           "let rec loop n sum = n eq 0 -> sum | loop (n - 1) (sum + " + step + ") in loop " +
+           std::to_string(repetitions) + " 0";
+}
+
+// Bytes allocated while evaluating the program
+std::size_t allocatedWhileEvaluating(const std::string &program)
+{
+    Lexer lexer(program);
+    TokenStorage::getInstance().setLexer(lexer);
+    Parser::parse();
+    TokenStorage::destroyInstance();
+
+    CustomTreeNode *root = CustomTree::getInstance().getASTRoot();
+    CSE cse;
+    cse.create_cs_fused(root);
+    CustomTreeNode::deleteNodeMemory(root);
+    CustomTree::getInstance().setASTRoot(nullptr);
+
+    std::size_t before = allocatedBytes;
+    cse.evaluate();
+    return allocatedBytes - before;
+}
+
+// Bytes allocated while printing the tuple the given number of times, the printed text goes to /dev/null
+std::size_t allocatedWhilePrinting(const CseNode &tuple, int repetitions)
+{
+    std::cout.flush();
+    int standardOutput = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+
+    CSE cse;
+    std::size_t before = allocatedBytes;
+    for (int i = 0; i < repetitions; i++)
+    {
+        cse.print_value(tuple);
+        OutputWriter::getInstance().flush();
+    }
+    std::size_t allocated = allocatedBytes - before;
+
+    dup2(standardOutput, 1);
+    close(standardOutput);
+    return allocated;
+}
+
+int main(int argc, char *argv[])
+{
+    int size = argc > 1 ? std::stoi(argv[1]) : 10000;
+
+    std::vector<std::pair<std::string, std::string>> steps = {
+        {"index", "T " + std::to_string(size)},
+        {"bind", "(fn t. t 1) T"},
+        {"tuple parameter", "(let f (a, b) = Order a in f P)"},
+        {"nested index", "(P 2) 1"}};
+
+    std::vector<std::pair<std::string, std::size_t>> extraBytes;
+
+    for (auto &step : steps)
+    {
+        std::size_t once = allocatedWhileEvaluating(loopProgram(size, REPETITIONS, step.second));
+        std::size_t twice = allocatedWhileEvaluating(loopProgram(size, 2 * REPETITIONS, step.second));
+        extraBytes.emplace_back(step.first, twice > once ? twice - once : 0);
+    }
+
+    std::vector<CseNode> elements;
+    for (int i = 1; i <= size; i++)
+    {
+        elements.emplace_back(TypeOfObject::INTEGER, std::to_string(i));
+    }
+    CseNode tuple(TypeOfObject::LIST, elements);
+    CseNode nested(TypeOfObject::LIST, {tuple, tuple});
+
+    std::size_t once = allocatedWhilePrinting(nested, REPETITIONS);
+    std::size_t twice = allocatedWhilePrinting(nested, 2 * REPETITIONS);
+    extraBytes.emplace_back("print", twice > once ? twice - once : 0);
+
+    bool passed = true;
+
+    std::cout << "step\ttuple size\tbytes per step" << std::endl;
+
+    for (auto &step : extraBytes)
+    {
+        std::size_t perStep = step.second / REPETITIONS;
+        std::cout << step.first << "\t" << size << "\t" << perStep;
+
+        // A copy of the elements alone takes more than a byte for every element
+        if (perStep >= static_cast<std::size_t>(size))
+        {
+            std::cout << "  <-- tuple copied";
+            passed = false;
+        }
+        std::cout << std::endl;
+    }
+
+    if (!passed)
+    {
+        std::cout << "FAILED: tuples are copied" << std::endl;
+        return 1;
+    }
+
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * Regression benchmark for superinstruction fusion.
+ *
+ * Evaluates recursive functions on integers, tuples and strings with and without fusion and counts the
+ * nodes the evaluation loop takes off the control. Each workload is made of the sequences fusion targets,
+ * identifiers applied to identifiers, operators applied to leaves, built-in functions and conditionals,
+ * so fusion has to save at least a quarter of the dispatches of every workload. The fused workloads are
+ * also timed without quickening and with the operands typed ahead of the evaluation, neither of which
+ * changes the dispatches, for comparison.
+ *
+ * Usage: ./dispatch_bench [size]
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../Parser.h"
+#include "../CSE.h"
+#include "../TypeInference.h"
+#include "Scaling.h"
+
+// Dispatches with fusion may be at most this fraction of the ones without it
+const double MAX_FUSED_FRACTION = 0.75;
+
+struct Workload
+{
+    std::string name;
+    std::string program; // program with n in place of the size
+};
+
+// Dispatches and milliseconds taken to evaluate the program, typed builds the ST and infers its types as -types does
+std::pair<long, double> evaluate(const std::string &program, bool fusion, bool quickening, bool typed = false)
+{
+    Lexer lexer(program);
+    TokenStorage::getInstance().setLexer(lexer);
+    Parser::parse();
+    TokenStorage::destroyInstance();
+
+    CustomTreeNode *root = CustomTree::getInstance().getASTRoot();
+    CSE cse;
+    cse.set_fusion(fusion);
+    cse.set_quickening(quickening);
+    if (typed)
+    {
+        CustomTree::generate();
+        TypeInference::infer();
+        cse.create_cs(CustomTree::getInstance().getSTRoot());
+        CustomTree::releaseSTMemory();
+        CustomTree::getInstance().setSTRoot(nullptr);
+    }
+    else
+    {
+        cse.create_cs_fused(root);
+        CustomTreeNode::deleteNodeMemory(root);
+        CustomTree::getInstance().setASTRoot(nullptr);
+    }
+
+    double time = timeMilliseconds([&]() { cse.evaluate(); });
+    return {cse.get_dispatches(), time};
+}
+
+int main(int argc, char *argv[])
+{
+    int size = argc > 1 ? std::stoi(argv[1]) : 20;
+
+    std::string tuple = "1";
+    for (int i = 2; i <= 1000; i++)
+    {
+        tuple += ", " + std::to_string(i);
+    }
+
+    std::vector<Workload> workloads = {
+        {"integers", "let rec fib n = n ls 2 -> n | fib (n - 1) + fib (n - 2) in fib n"},
+        {"tuple", "let T = (" + tuple + ") in let rec sum i = i gr Order T -> 0 | T i + sum (i + 1) in "
+                  "let rec repeat k = k eq 0 -> 0 | sum 1 + repeat (k - 1) in repeat n"},
+        {"string", "let rec length s = s eq '' -> 0 | 1 + length (Stern s) in "
+                   "let rec repeat k = k eq 0 -> 0 | length 'abcdefghijklmnopqrstuvwxyz' + repeat (k - 1) in "
+                   "repeat (100 * n)"}};
+
+    bool passed = true;
+
+    std::cout << "workload\tdispatches\tfused\tfraction\ttime ms\tfused ms\tnot quickened ms\ttyped ms" << std::endl;
+
+    for (auto &workload : workloads)
+    {
+        std::string program = workload.program;
+        program.replace(program.rfind(" n"), 2, " " + std::to_string(size));
+
+        std::pair<long, double> plain = evaluate(program, false, true);
+        std::pair<long, double> fused = evaluate(program, true, true);
+        std::pair<long, double> unquickened = evaluate(program, true, false);
+        std::pair<long, double> typed = evaluate(program, true, true, true);
+
+        double fraction = static_cast<double>(fused.first) / static_cast<double>(plain.first);
+        std::cout << workload.name << "\t" << plain.first << "\t" << fused.first << "\t" << fraction << "\t"
+                  << plain.second << "\t" << fused.second << "\t" << unquickened.second << "\t" << typed.second;
+
+        if (fraction > MAX_FUSED_FRACTION)
+        {
+            std::cout << "  <-- not fused";
+            passed = false;
+        }
+        std::cout << std::endl;
+    }
+
+    if (!passed)
+    {
+        std::cout << "FAILED: fusion does not save dispatches" << std::endl;
+        return 1;
+    }
+
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
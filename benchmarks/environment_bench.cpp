@@ -0,0 +1,111 @@
+/**
+ * Regression benchmark for the allocations of environments.
+ *
+ * Counts the allocations made by calls that bind one name, a tuple of two names, two curried
+ * arguments and a tuple of more names than an environment keeps inline. Calls bind their arguments
+ * in frames that are reused, and a call whose body creates a closure that looks up f allocates the
+ * environment the closure copies f into. A call with all the arguments of a curried function binds
+ * them in one frame. Calls that bind no more than Environment::INLINE_BINDINGS names keep their
+ * bindings in the environment itself, and a frame that binds more keeps the capacity of its
+ * bindings from one call to the next, so a call allocates one closure environment at most, besides
+ * the values it computes.
+ *
+ * Every workload calls f twice from every call until the depth runs out, so doubling the number of
+ * calls makes the recursion only one call deeper.
+ *
+ * Usage: ./environment_bench [depth]
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../Parser.h"
+#include "../CSE.h"
+#include "AllocationCounter.h"
+
+struct Workload
+{
+    std::string name;
+    std::string function; // definition of f, which counts n down to 0
+    std::string call;     // the first call of f, with n in place of the depth
+    double allowed;       // allocations per call at most
+};
+
+// Allocations and bytes allocated while evaluating the program
+std::pair<std::size_t, std::size_t> allocatedWhileEvaluating(const std::string &program)
+{
+    Lexer lexer(program);
+    TokenStorage::getInstance().setLexer(lexer);
+    Parser::parse();
+    TokenStorage::destroyInstance();
+
+    CustomTreeNode *root = CustomTree::getInstance().getASTRoot();
+    CSE cse;
+    cse.create_cs_fused(root);
+    CustomTreeNode::deleteNodeMemory(root);
+    CustomTree::getInstance().setASTRoot(nullptr);
+
+    std::size_t allocationsBefore = allocations;
+    std::size_t bytesBefore = allocatedBytes;
+    cse.evaluate();
+    return {allocations - allocationsBefore, allocatedBytes - bytesBefore};
+}
+
+std::string program(const Workload &workload, int depth)
+{
+    std::string call = workload.call;
+    call.replace(call.find('n'), 1, std::to_string(depth));
+    return "let rec " + workload.function + " in " + call;
+}
+
+int main(int argc, char *argv[])
+{
+    int depth = argc > 1 ? std::stoi(argv[1]) : 16;
+
+    // a tuple argument takes three allocations, its elements while they are collected, its elements and their count
+    // of owners, and the environment of a closure one
+    std::vector<Workload> workloads = {
+        {"one name, frame", "f n = n eq 0 -> 0 | f (n - 1) + f (n - 1)", "f n", 0},
+        {"two names, frame", "f (n, s) = n eq 0 -> s | f (n - 1, s) + f (n - 1, s)", "f (n, 0)", 3},
+        {"one name, closure", "f n = n eq 0 -> 0 | (fn x. f x) (n - 1) + (fn x. f x) (n - 1)", "f n", 1},
+        {"two names, closure", "f (n, s) = n eq 0 -> s | (fn x. f x) (n - 1, s) + (fn x. f x) (n - 1, s)", "f (n, 0)", 4},
+        {"two names, curried", "f n s = n eq 0 -> s | f (n - 1) s + f (n - 1) s", "f n 0", 0},
+        {"four names, frame", "f (n, a, b, c) = n eq 0 -> a | f (n - 1, a, b, c) + f (n - 1, a, b, c)",
+         "f (n, 0, 0, 0)", 3}};
+
+    bool passed = true;
+
+    std::cout << "environment size " << sizeof(Environment) << " bytes, " << Environment::INLINE_BINDINGS
+              << " bindings inline" << std::endl;
+    std::cout << "workload\tcalls\tallocations per call\tbytes per call" << std::endl;
+
+    for (auto &workload : workloads)
+    {
+        std::pair<std::size_t, std::size_t> once = allocatedWhileEvaluating(program(workload, depth));
+        std::pair<std::size_t, std::size_t> twice = allocatedWhileEvaluating(program(workload, depth + 1));
+
+        // 2^(depth + 1) - 1 calls, then 2^(depth + 2) - 1
+        double calls = static_cast<double>(1 << (depth + 1));
+
+        double perCall = static_cast<double>(twice.first - once.first) / calls;
+        double bytesPerCall = static_cast<double>(twice.second - once.second) / calls;
+        std::cout << workload.name << "\t" << calls << "\t" << perCall << "\t" << bytesPerCall;
+
+        if (perCall > workload.allowed + 0.1)
+        {
+            std::cout << "  <-- bindings allocated";
+            passed = false;
+        }
+        std::cout << std::endl;
+    }
+
+    if (!passed)
+    {
+        std::cout << "FAILED: calls allocate their bindings" << std::endl;
+        return 1;
+    }
+
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
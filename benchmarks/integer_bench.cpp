@@ -0,0 +1,108 @@
+/**
+ * Benchmark for big integer multiplication.
+ *
+ * Computes factorials one factor at a time (a big number times a small one, as an RPAL
+ * factorial does), with a product tree (big numbers of equal size multiplied together) and by
+ * squaring them, once with schoolbook multiplication only and once with Karatsuba multiplication
+ * above the default threshold. Both must give the same digits.
+ *
+ * Usage: ./integer_bench [largest_factorial]
+ */
+
+#include <iostream>
+#include <string>
+
+#include "../Integer.h"
+#include "Scaling.h"
+
+// 1 * 2 * ... * n
+Integer sequentialFactorial(int n)
+{
+    Integer product(1);
+    for (int i = 2; i <= n; i++)
+    {
+        product = product * Integer(i);
+    }
+    return product;
+}
+
+// from * (from + 1) * ... * to, multiplying halves of equal size
+Integer productTree(int from, int to)
+{
+    if (to - from < 8)
+    {
+        Integer product(1);
+        for (int i = from; i <= to; i++)
+        {
+            product = product * Integer(i);
+        }
+        return product;
+    }
+
+    int middle = from + (to - from) / 2;
+    return productTree(from, middle) * productTree(middle + 1, to);
+}
+
+Integer squaredFactorial(int n)
+{
+    Integer factorial = productTree(1, n);
+    return factorial * factorial;
+}
+
+// Fastest time of the given work in milliseconds, the result is kept in the given string
+double bestTime(const std::function<Integer()> &work, std::string &digits)
+{
+    double best = 0;
+    for (int i = 0; i < REPETITIONS; i++)
+    {
+        double time = timeMilliseconds([&] { digits = work().to_string(); });
+        best = i == 0 ? time : std::min(best, time);
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    int largest = argc > 1 ? std::stoi(argv[1]) : 20000;
+    size_t defaultThreshold = Integer::karatsubaThreshold;
+
+    std::vector<std::pair<std::string, std::function<Integer(int)>>> workloads = {
+        {"sequential", sequentialFactorial},
+        {"product tree", [](int n) { return productTree(1, n); }},
+        {"squared", squaredFactorial}};
+
+    bool passed = true;
+
+    std::cout << "workload\tn\tschoolbook ms\tkaratsuba ms" << std::endl;
+
+    for (auto &workload : workloads)
+    {
+        for (int n = 1000; n <= largest; n *= 4)
+        {
+            std::string schoolbookDigits, karatsubaDigits;
+
+            Integer::karatsubaThreshold = static_cast<size_t>(-1);
+            double schoolbook = bestTime([&] { return workload.second(n); }, schoolbookDigits);
+
+            Integer::karatsubaThreshold = defaultThreshold;
+            double karatsuba = bestTime([&] { return workload.second(n); }, karatsubaDigits);
+
+            std::cout << workload.first << "\t" << n << "\t" << schoolbook << "\t" << karatsuba << std::endl;
+
+            if (schoolbookDigits != karatsubaDigits)
+            {
+                std::cout << "  <-- results differ" << std::endl;
+                passed = false;
+            }
+        }
+    }
+
+    if (!passed)
+    {
+        std::cout << "FAILED: multiplication methods disagree" << std::endl;
+        return 1;
+    }
+
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * Regression benchmark for Print.
+ *
+ * Prints wide tuples and deeply nested tuples to /dev/null. Tuples are printed in one pass over
+ * their elements, so doubling the number of elements should roughly double the time whatever
+ * the nesting is.
+ *
+ * Usage: ./print_bench [largest_size]
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../CSE.h"
+#include "Scaling.h"
+
+// (1, 2, ..., size)
+CseNode wideTuple(int size)
+{
+    std::vector<CseNode> elements;
+    for (int i = 1; i <= size; i++)
+    {
+        elements.emplace_back(TypeOfObject::INTEGER, std::to_string(i));
+    }
+    return CseNode(TypeOfObject::LIST, elements);
+}
+
+// (1, (2, (3, ... (size - 1, size)))), built from the innermost tuple out as tau builds it
+CseNode nestedTuple(int size)
+{
+    CseNode tuple(TypeOfObject::INTEGER, std::to_string(size));
+    for (int i = size - 1; i >= 1; i--)
+    {
+        tuple = CseNode(TypeOfObject::LIST, {CseNode(TypeOfObject::INTEGER, std::to_string(i)), tuple});
+    }
+    return tuple;
+}
+
+// ('text', nil, ('text', nil), ...) with strings and empty tuples
+CseNode mixedTuple(int size)
+{
+    CseNode nil(TypeOfObject::LIST, std::vector<CseNode>());
+    CseNode inner(TypeOfObject::LIST, {CseNode(TypeOfObject::STRING, "text"), nil});
+
+    std::vector<CseNode> elements;
+    for (int i = 0; i < size / 4; i++)
+    {
+        elements.emplace_back(TypeOfObject::STRING, "text");
+        elements.push_back(nil);
+        elements.push_back(inner);
+    }
+    return CseNode(TypeOfObject::LIST, elements);
+}
+
+// Milliseconds taken to print the tuple, the printed text goes to /dev/null
+double timePrint(CSE &cse, const CseNode &tuple)
+{
+    std::cout.flush();
+    int standardOutput = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+
+    double time = timeMilliseconds([&]
+                                   {
+                                       cse.print_value(tuple);
+                                       OutputWriter::getInstance().flush(); });
+
+    dup2(standardOutput, 1);
+    close(standardOutput);
+    return time;
+}
+
+int main(int argc, char *argv[])
+{
+    int largestSize = argc > 1 ? std::stoi(argv[1]) : 1000000;
+
+    std::vector<std::pair<std::string, CseNode (*)(int)>> shapes = {
+        {"wide", wideTuple},
+        {"nested", nestedTuple},
+        {"mixed", mixedTuple}};
+
+    bool passed = true;
+    CSE cse;
+
+    for (auto &shape : shapes)
+    {
+        CseNode tuple;
+        int builtSize = 0;
+
+        passed &= checkLinearScaling(shape.first, largestSize, [&](int size)
+                                     {
+                                         // every size is built once and printed once before it is timed, so the
+                                         // timings do not depend on how much of the new tuple is still cached
+                                         if (size != builtSize)
+                                         {
+                                             tuple = shape.second(size);
+                                             builtSize = size;
+                                             timePrint(cse, tuple);
+                                         }
+                                         return timePrint(cse, tuple); });
+    }
+
+    if (!passed)
+    {
+        std::cout << "FAILED: printing does not scale linearly" << std::endl;
+        return 1;
+    }
+
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
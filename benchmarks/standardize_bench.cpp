@@ -0,0 +1,106 @@
+/**
+ * Regression benchmark for the standardizer.
+ *
+ * Builds programs whose nodes have a very wide list of children (tuples, simultaneous
+ * definitions, curried functions and lambdas) and times the generation of the Standardized
+ * Tree (ST) for growing sizes. Standardizing must stay linear in the number of children,
+ * so doubling the size should roughly double the time.
+ *
+ * Usage: ./standardize_bench [largest_size]
+ */
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../Parser.h"
+#include "Scaling.h"
+
+/**
+ * Parses the program and returns the time taken to standardize its AST in milliseconds.
+ */
+double timeStandardize(const std::string &program)
+{
+    Lexer lexer(program);
+    TokenStorage::getInstance().setLexer(lexer);
+    Parser::parse();
+    TokenStorage::destroyInstance();
+
+    CustomTree::getInstance().setSTRoot(nullptr);
+
+    double time = timeMilliseconds([] { CustomTree::generate(); });
+
+    CustomTree::releaseSTMemory();
+    CustomTree::getInstance().setSTRoot(nullptr);
+
+    return time;
+}
+
+std::string tupleProgram(int size)
+{
+    std::string program = "Print (1";
+    for (int i = 2; i <= size; i++)
+    {
+        program += ", " + std::to_string(i);
+    }
+    return program + ")";
+}
+
+std::string andProgram(int size)
+{
+    std::string program = "let x1 = 1";
+    for (int i = 2; i <= size; i++)
+    {
+        program += " and x" + std::to_string(i) + " = " + std::to_string(i);
+    }
+    return program + " in Print x1";
+}
+
+std::string functionFormProgram(int size)
+{
+    std::string program = "let f";
+    for (int i = 1; i <= size; i++)
+    {
+        program += " a" + std::to_string(i);
+    }
+    return program + " = a1 in Print f";
+}
+
+std::string lambdaProgram(int size)
+{
+    std::string program = "Print (fn";
+    for (int i = 1; i <= size; i++)
+    {
+        program += " a" + std::to_string(i);
+    }
+    return program + ". a1)";
+}
+
+int main(int argc, char *argv[])
+{
+    int largestSize = argc > 1 ? std::stoi(argv[1]) : 100000;
+
+    std::vector<std::pair<std::string, std::function<std::string(int)>>> shapes = {
+        {"tuple", tupleProgram},
+        {"and", andProgram},
+        {"fcn_form", functionFormProgram},
+        {"lambda", lambdaProgram}};
+
+    bool passed = true;
+
+    for (auto &shape : shapes)
+    {
+        passed &= checkLinearScaling(shape.first, largestSize,
+                                     [&shape](int size) { return timeStandardize(shape.second(size)); });
+    }
+
+    if (!passed)
+    {
+        std::cout << "FAILED: standardizing does not scale linearly" << std::endl;
+        return 1;
+    }
+
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * Regression benchmark for string values.
+ *
+ * Builds strings one character at a time with Conc, at the end and at the front, and takes
+ * them apart again with Stem and Stern, the way RPAL text-formatting programs do. Each step
+ * must take amortized constant time, so doubling the length should roughly double the time.
+ *
+ * Usage: ./string_bench [largest_length]
+ */
+
+#include <iostream>
+#include <string>
+
+#include "../RpalString.h"
+#include "Scaling.h"
+
+const RpalString EMPTY;
+const RpalString CHARACTER("a");
+
+// Conc s 'a', repeated
+RpalString appendCharacters(int length)
+{
+    RpalString text;
+    for (int i = 0; i < length; i++)
+    {
+        text = text.concat(CHARACTER);
+    }
+    return text;
+}
+
+// Conc 'a' s, repeated
+RpalString prependCharacters(int length)
+{
+    RpalString text;
+    for (int i = 0; i < length; i++)
+    {
+        text = CHARACTER.concat(text);
+    }
+    return text;
+}
+
+// s eq '' -> n | count (Stern s) (n + Stem s eq 'a')
+int countCharacters(RpalString text)
+{
+    int count = 0;
+    while (text != EMPTY)
+    {
+        count += text.stem() == CHARACTER ? 1 : 0;
+        text = text.stern();
+    }
+    return count;
+}
+
+// Conc (reverse (Stern s)) (Stem s), the result is built from slices of the original string
+RpalString reverseCharacters(RpalString text)
+{
+    RpalString reversed;
+    while (!text.empty())
+    {
+        reversed = text.stem().concat(reversed);
+        text = text.stern();
+    }
+    return reversed;
+}
+
+int main(int argc, char *argv[])
+{
+    int largestLength = argc > 1 ? std::stoi(argv[1]) : 1000000;
+
+    bool passed = true;
+    int checksum = 0;
+
+    passed &= checkLinearScaling("append", largestLength, [&checksum](int length)
+                                 { return timeMilliseconds([&] { checksum += appendCharacters(length).length(); }); });
+
+    passed &= checkLinearScaling("prepend", largestLength, [&checksum](int length)
+                                 { return timeMilliseconds([&] { checksum += prependCharacters(length).length(); }); });
+
+    passed &= checkLinearScaling("stern", largestLength, [&checksum](int length)
+                                 {
+                                     RpalString text = appendCharacters(length);
+                                     return timeMilliseconds([&] { checksum += countCharacters(text); }); });
+
+    passed &= checkLinearScaling("reverse", largestLength, [&checksum](int length)
+                                 {
+                                     RpalString text = appendCharacters(length);
+                                     return timeMilliseconds([&] { checksum += reverseCharacters(text).length(); }); });
+
+    // Keeps the work from being optimized away
+    std::cout << "checksum " << checksum << std::endl;
+
+    if (!passed)
+    {
+        std::cout << "FAILED: string operations do not scale linearly" << std::endl;
+        return 1;
+    }
+
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
@@ -1,11 +1,17 @@
+#include <algorithm>
+#include <cctype>
 #include <string>
 #include <fstream>
 #include <unordered_map>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include "Parser.h"
 #include "Token.h"
 #include "CSE.h"
+#include "Optimizer.h"
+#include "TypeInference.h"
 
 using namespace std;
 
@@ -65,73 +71,84 @@ void printGraphvizWarning()
 }
 
 /**
- * Helper function to generate the dot file contents recursively.
+ * Helper function to generate the dot file contents.
+ * Nodes are written in pre-order, the nodes still to be written are kept on an explicit stack
+ * so that deep trees can be visualized.
  *
- * @param node The current CustomTreeNode being processed.
+ * @param root The root CustomTreeNode of the tree.
  * @param file The ofstream object for writing the dot file.
- * @param parent The parent node ID (default: -1).
- * @return The ID of the current node.
+ * @param parent The parent node ID of the root (default: -1).
+ * @return The number of nodes written.
  */
-int generateDotFileHelper(CustomTreeNode *node, std::ofstream &file, int parent = -1, int nodeCount = 0)
+int generateDotFileHelper(CustomTreeNode *root, std::ofstream &file, int parent = -1)
 {
-    int currentNode = nodeCount;
+    // Pending nodes with the ID of their parent node
+    std::vector<std::pair<CustomTreeNode *, int>> pendingNodes = {{root, parent}};
+    int nodeCount = 0;
 
-    // Increment nodeCount for the next call
-    int nextNodeCount = nodeCount + 1;
+    while (!pendingNodes.empty())
+    {
+        CustomTreeNode *node = pendingNodes.back().first;
+        int parentNode = pendingNodes.back().second;
+        pendingNodes.pop_back();
 
-    // Determine colors and fill based on node values
-    std::string labelColor = "darkblue";
-    std::string valueColor = "darkgreen";
-    std::string fillColor = (node->getValue() == " " || node->getValue().empty()) ? "#CCCCCC" : "#FFFFFF";
+        int currentNode = nodeCount++;
 
-    // Escape labelOfNode characters if necessary
-    std::string escapedLabel = node->getLabel();
+        // Determine colors and fill based on node values
+        std::string labelColor = "darkblue";
+        std::string valueColor = "darkgreen";
+        std::string fillColor = (node->getValue() == " " || node->getValue().empty()) ? "#CCCCCC" : "#FFFFFF";
 
-    size_t pos1 = escapedLabel.find('&');
-    while (pos1 != std::string::npos)
-    {
-        escapedLabel.replace(pos1, 1, "&amp;");
-        pos1 = escapedLabel.find('&', pos1 + 5); // Move to the next occurrence after the replaced token
-    }
+        // Escape labelOfNode characters if necessary
+        std::string escapedLabel = node->getLabel();
 
-    size_t pos = escapedLabel.find('>');
-    while (pos != std::string::npos)
-    {
-        escapedLabel.replace(pos, 1, "&gt;");
-        pos = escapedLabel.find('>', pos + 4);
-    }
+        size_t pos1 = escapedLabel.find('&');
+        while (pos1 != std::string::npos)
+        {
+            escapedLabel.replace(pos1, 1, "&amp;");
+            pos1 = escapedLabel.find('&', pos1 + 5); // Move to the next occurrence after the replaced token
+        }
 
-    // Prepare labelOfNode and value strings for the dot file
-    std::string labelStr = (escapedLabel.empty()) ? "&nbsp;" : escapedLabel;
-    std::string valueStr = (node->getValue().empty()) ? "&nbsp;" : node->getValue();
+        size_t pos = escapedLabel.find('>');
+        while (pos != std::string::npos)
+        {
+            escapedLabel.replace(pos, 1, "&gt;");
+            pos = escapedLabel.find('>', pos + 4);
+        }
 
-    size_t pos2 = valueStr.find('\n');
+        // Prepare labelOfNode and value strings for the dot file
+        std::string labelStr = (escapedLabel.empty()) ? "&nbsp;" : escapedLabel;
+        std::string valueStr = (node->getValue().empty()) ? "&nbsp;" : node->getValue();
 
-    while (pos2 != std::string::npos)
-    {
-        valueStr.replace(pos2, 1, "\\n");
-        pos2 = valueStr.find('\n', pos2 + 2);
-    }
+        size_t pos2 = valueStr.find('\n');
 
-    // Write the node details to the dot file
-    file << "    node" << currentNode << " [labelOfNode=<";
-    file << "<font color=\"" << labelColor << "\">" << labelStr << "</font><br/>";
-    file << "<font color=\"" << valueColor << "\">" << valueStr << "</font>";
-    file << ">, style=filled, fillcolor=\"" << fillColor << "\"];\n";
+        while (pos2 != std::string::npos)
+        {
+            valueStr.replace(pos2, 1, "\\n");
+            pos2 = valueStr.find('\n', pos2 + 2);
+        }
 
-    // Connect the current node to its parent (if not the root)
-    if (currentNode != 0 && parent != -1)
-    {
-        file << "    node" << parent << " -> node" << currentNode << ";\n";
-    }
+        // Write the node details to the dot file
+        file << "    node" << currentNode << " [labelOfNode=<";
+        file << "<font color=\"" << labelColor << "\">" << labelStr << "</font><br/>";
+        file << "<font color=\"" << valueColor << "\">" << valueStr << "</font>";
+        file << ">, style=filled, fillcolor=\"" << fillColor << "\"];\n";
 
-    // Recursively generate dot file contents for each child node
-    for (CustomTreeNode *child : node->getChildren())
-    {
-        nextNodeCount = generateDotFileHelper(child, file, currentNode, nextNodeCount);
+        // Connect the current node to its parent (if not the root)
+        if (currentNode != 0 && parentNode != -1)
+        {
+            file << "    node" << parentNode << " -> node" << currentNode << ";\n";
+        }
+
+        // Push the children in reverse so that they are written in order
+        std::vector<CustomTreeNode *> &children = node->getChildren();
+        for (auto it = children.rbegin(); it != children.rend(); ++it)
+        {
+            pendingNodes.emplace_back(*it, currentNode);
+        }
     }
 
-    return nextNodeCount;
+    return nodeCount;
 }
 
 /**
@@ -159,7 +176,7 @@ int main(int argc, char *argv[])
     if (argc < 2  || std::string(argv[1]) == "-visualize")
     {
         // std::cout << "Usage: .\\rpal20 input_file [-visualize=VALUE]" << std::endl;
-        std::cout << "\033[1;31mERROR: \033[0m" << "Usage: .\\rpal20 input_file [-visualize=VALUE]" << "\n" << std::endl;
+        std::cout << "\033[1;31mERROR: \033[0m" << "Usage: .\\rpal20 input_file [-visualize=VALUE] [-O0|-O1] [-types] [-memoize[=N]] [-parallel[=N]] [-speculate[=N]] [-stats]" << "\n" << std::endl;
         return 1;
     }
 
@@ -178,6 +195,12 @@ int main(int argc, char *argv[])
     std::string visualizeArg;
     bool visualizeAst = false;
     bool visualizeSt = false;
+    bool optimize = false;
+    bool inferTypes = false;         // prove integer and tuple operands ahead of the evaluation
+    std::size_t memoizeCapacity = 0; // entries of the memo table, 0 when results are not memoized
+    unsigned parallelThreads = 0;    // threads evaluating the program with -parallel, 0 when it is sequential
+    int speculationBudget = 0;       // branches evaluated ahead at the same time with -speculate, 0 without it
+    bool stats = false;              // report the superinstructions fused and the nodes evaluated
 
     for (int i = 2; i < argc; ++i)
     {
@@ -196,6 +219,76 @@ int main(int argc, char *argv[])
         {
             visualizeSt = true;
         }
+        else if (arg == "-O0")
+        {
+            optimize = false;
+        }
+        else if (arg == "-O1")
+        {
+            optimize = true;
+        }
+        else if (arg == "-types")
+        {
+            inferTypes = true;
+        }
+        else if (arg == "-stats")
+        {
+            stats = true;
+        }
+        else if (arg == "-memoize")
+        {
+            memoizeCapacity = MemoTable::DEFAULT_CAPACITY;
+        }
+        else if (arg.rfind("-memoize=", 0) == 0)
+        {
+            std::string capacity = arg.substr(9);
+
+            if (capacity.empty() || capacity.size() > 9 ||
+                !std::all_of(capacity.begin(), capacity.end(), [](unsigned char c) { return std::isdigit(c); }) ||
+                std::stoul(capacity) == 0)
+            {
+                std::cout << "\033[1;31mERROR: \033[0m" << "Invalid memo table size: " << capacity << "\n" << std::endl;
+                return 1;
+            }
+
+            memoizeCapacity = std::stoul(capacity);
+        }
+        else if (arg == "-parallel")
+        {
+            parallelThreads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        else if (arg.rfind("-parallel=", 0) == 0)
+        {
+            std::string threads = arg.substr(10);
+
+            if (threads.empty() || threads.size() > 3 ||
+                !std::all_of(threads.begin(), threads.end(), [](unsigned char c) { return std::isdigit(c); }) ||
+                std::stoul(threads) == 0)
+            {
+                std::cout << "\033[1;31mERROR: \033[0m" << "Invalid number of threads: " << threads << "\n" << std::endl;
+                return 1;
+            }
+
+            parallelThreads = static_cast<unsigned>(std::stoul(threads));
+        }
+        else if (arg == "-speculate")
+        {
+            speculationBudget = -1; // as many as there are threads
+        }
+        else if (arg.rfind("-speculate=", 0) == 0)
+        {
+            std::string budget = arg.substr(11);
+
+            if (budget.empty() || budget.size() > 4 ||
+                !std::all_of(budget.begin(), budget.end(), [](unsigned char c) { return std::isdigit(c); }) ||
+                std::stoi(budget) == 0)
+            {
+                std::cout << "\033[1;31mERROR: \033[0m" << "Invalid speculation budget: " << budget << "\n" << std::endl;
+                return 1;
+            }
+
+            speculationBudget = std::stoi(budget);
+        }
     }
 
     if (!isGraphvizInstalled())
@@ -247,11 +340,44 @@ int main(int argc, char *argv[])
         std::cout << "The ast.png file is located in the Visualizations folder." << std::endl;
     }
 
-    CustomTree::generate();
-    CustomTreeNode *st_root = CustomTree::getInstance().getSTRoot();
+    CSE cse = CSE();
+
+    // speculation runs branches on the threads of -parallel, all of the cores are used when it is not given
+    if (speculationBudget != 0 && parallelThreads == 0)
+    {
+        parallelThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    if (parallelThreads > 0)
+    {
+        cse.set_parallel(parallelThreads);
+    }
+    if (speculationBudget != 0)
+    {
+        cse.set_speculation(speculationBudget < 0 ? static_cast<int>(parallelThreads) : speculationBudget);
+    }
+
+    // The ST is only built when it is visualized, optimized or typed, otherwise the control structures are built from the AST
+    bool buildSt = visualizeSt || optimize || inferTypes;
+
+    if (buildSt)
+    {
+        CustomTree::generate();
+
+        if (optimize)
+        {
+            Optimizer::optimize();
+        }
+        if (inferTypes)
+        {
+            TypeInference::infer();
+        }
+    }
 
     if (visualizeSt)
     {
+        CustomTreeNode *st_root = CustomTree::getInstance().getSTRoot();
+
         generateDotFile(st_root, "st.dot");
 
          std::string dotFilePath_st = R"("D:\Files\Academics\Semester_04\PL\RPAL_CLION\Visualizations\st.dot")";
@@ -266,11 +392,44 @@ int main(int argc, char *argv[])
         std::cout << "The st.png file is located in the Visualizations folder." << std::endl;
     }
 
-    CSE cse = CSE();
-    cse.create_cs(CustomTree::getInstance().getSTRoot());
-    cse.evaluate();
+    if (buildSt)
+    {
+        cse.create_cs(CustomTree::getInstance().getSTRoot());
+        CustomTree::releaseSTMemory();
+        CustomTree::getInstance().setSTRoot(nullptr);
+    }
+    else
+    {
+        cse.create_cs_fused(root);
+        CustomTreeNode::deleteNodeMemory(root);
+        CustomTree::getInstance().setASTRoot(nullptr);
+    }
+
+    if (memoizeCapacity > 0)
+    {
+        cse.set_memoize(memoizeCapacity);
+    }
+
+    OutputWriter &output = OutputWriter::getInstance();
+
+    try
+    {
+        cse.evaluate();
+    }
+    catch (...)
+    {
+        // Keep what the program printed before it failed
+        output.flush();
+        throw;
+    }
+
+    output.write('\n');
+    output.flush();
 
-    std::cout << std::endl;
+    if (stats)
+    {
+        cse.write_stats(std::cerr);
+    }
 
     return 0;
 }
\ No newline at end of file
@@ -52,8 +52,18 @@ echo[
 echo[
 .\rpal20 testcases/add
 echo[
+.\rpal20 testcases/bignum1
+echo[
 .\rpal20 testcases/conc.1
 echo[
+.\rpal20 testcases/curry1
+echo[
+.\rpal20 testcases/curry2
+echo[
+.\rpal20 testcases/deep1
+echo[
+.\rpal20 testcases/deep2
+echo[
 .\rpal20 testcases/defns.1
 echo[
 .\rpal20 testcases/fn1
@@ -62,10 +72,16 @@ echo[
 echo[
 .\rpal20 testcases/fn3
 echo[
+.\rpal20 testcases/fold1
+echo[
 .\rpal20 testcases/infix
 echo[
 .\rpal20 testcases/infix2
 echo[
+.\rpal20 testcases/inline1
+echo[
+.\rpal20 testcases/memo1
+echo[
 .\rpal20 testcases/pairs1
 echo[
 .\rpal20 testcases/pairs2
@@ -78,8 +94,18 @@ echo[
 echo[
 .\rpal20 testcases/pl2019.txt
 echo[
+.\rpal20 testcases/power1
+echo[
+.\rpal20 testcases/rec1
+echo[
+.\rpal20 testcases/rec2
+echo[
 .\rpal20 testcases/towers
 echo[
+.\rpal20 testcases/tuple1
+echo[
+.\rpal20 testcases/types1
+echo[
 .\rpal20 testcases/vectorsum
 echo[
 .\rpal20 testcases/z.txt